@@ -0,0 +1,93 @@
+#ifndef MATH_ACCUMULATOR_H
+#define MATH_ACCUMULATOR_H
+
+#include "math_Rational.h"
+
+namespace math
+{
+    // Running sum of rationals, kept as an unreduced fraction a/b (b > 0).
+    // The fraction is reduced only when the denominator has doubled in size
+    // since the last reduction, or on demand by normalize().
+    class Accumulator
+    {
+    public:
+        Accumulator(const Rational& u = 0,
+            int reduce_bits = MIN_REDUCE_BITS) :
+            a(u.numerator()),
+            b(u.denominator()),
+            min_bits(reduce_bits),
+            limit(reduce_bits)
+        {
+            // empty
+        }
+
+        Accumulator& operator+= (const Rational& rhs)
+        {
+            add(rhs.numerator(), rhs.denominator());
+            return *this;
+        }
+
+        Accumulator& operator-= (const Rational& rhs)
+        {
+            add(-rhs.numerator(), rhs.denominator());
+            return *this;
+        }
+
+        // Reduce a/b to lowest terms.
+        void normalize()
+        {
+            const Integer g = gcd(a.abs(), b.abs());
+            if (g != 1)
+            {
+                a /= g;
+                b /= g;
+            }
+            limit = std::max(min_bits, 2 * b.abs().bits());
+        }
+
+        // Return the sum, in lowest terms.
+        Rational value() const
+        {
+            return Rational(a, b);
+        }
+
+        std::string to_string() const
+        {
+            return value().to_string();
+        }
+
+    private:
+        Integer a;
+        Integer b;
+        int min_bits;
+        int limit;
+
+        // Denominator size (in bits) below which sums are never reduced.
+        static const int MIN_REDUCE_BITS = 1024;
+
+        // Add c/d (d > 0) to a/b.
+        void add(const Integer& c, const Integer& d)
+        {
+            if (d == b)
+            {
+                a += c;
+            }
+            else if (d == 1)
+            {
+                a += c * b;
+            }
+            else
+            {
+                a *= d;
+                a += b * c;
+                b *= d;
+                if (b.abs().bits() > limit)
+                {
+                    normalize();
+                }
+            }
+        }
+    };
+} // namespace math
+
+#endif // MATH_ACCUMULATOR_H
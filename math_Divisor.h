@@ -0,0 +1,267 @@
+#ifndef MATH_DIVISOR_H
+#define MATH_DIVISOR_H
+
+#include "math_Unsigned.h"
+
+namespace math
+{
+    // Divisor reused for many divisions, normalized once, with a reciprocal
+    // for quotient estimation (Moller and Granlund, "Improved division by
+    // invariant integers"): a 2/1 digit reciprocal for single-digit divisors,
+    // a 3/2 digit reciprocal for schoolbook division, and a full reciprocal
+    // for divisors of at least BZ_THRESHOLD digits.
+    class Divisor
+    {
+    public:
+        typedef Unsigned::Digit Digit;
+        typedef Unsigned::Wigit Wigit;
+
+        explicit Divisor(const Unsigned& divisor) :
+            d(divisor),
+            v(divisor),
+            shift(Unsigned::BITS),
+            n(divisor.digits.size()),
+            v_inv(0),
+            x()
+        {
+            if (divisor == 0)
+            {
+                throw std::overflow_error("Error: Divisor::overflow");
+            }
+
+            // Normalize divisor (v[n-1] >= BASE/2).
+            for (Digit vn = divisor.digits.back(); vn != 0; vn >>= 1, --shift);
+            v <<= shift;
+            const Unsigned& w = v;
+            if (n == 1)
+            {
+                // v_inv = floor((BASE^2 - 1) / v) - BASE.
+                v_inv = static_cast<Digit>(~static_cast<Wigit>(0) /
+                    w.digits[0]);
+            }
+            else if (n < Unsigned::BZ_THRESHOLD)
+            {
+                // v_inv = floor((BASE^3 - 1) / (v1 BASE + v0)) - BASE.
+                Unsigned t = w.slice(n - 2, 2);
+                Unsigned e;
+                e.digits.assign(3, ~static_cast<Digit>(0));
+                v_inv = (e / t).digits[0];
+            }
+            else
+            {
+                x = Unsigned::reciprocal(w);
+            }
+        }
+
+        const Unsigned& divisor() const
+        {
+            return d;
+        }
+
+        friend Unsigned operator/ (const Unsigned& u, const Divisor& v)
+        {
+            Unsigned q, r;
+            v.divide(u, q, r);
+            return q;
+        }
+
+        friend Unsigned operator% (const Unsigned& u, const Divisor& v)
+        {
+            Unsigned q, r;
+            v.divide(u, q, r);
+            return r;
+        }
+
+        // Compute quotient q and remainder r of u divided by this.
+        void divide(const Unsigned& u, Unsigned& q, Unsigned& r) const
+        {
+            if (u.digits.size() < n)
+            {
+                r = u;
+                q.digits.assign(1, 0);
+            }
+            else if (n == 1)
+            {
+                divide_1(u, q, r);
+            }
+            else if (n < Unsigned::BZ_THRESHOLD)
+            {
+                divide_schoolbook(u, q, r);
+            }
+            else
+            {
+                divide_newton(u, q, r);
+            }
+        }
+
+    private:
+        Unsigned d;
+        Unsigned v;
+        unsigned shift;
+        size_t n;
+        Digit v_inv;
+        Unsigned x;
+
+        // Return quotient of u1 BASE + u0 divided by normalized v, with
+        // u1 < v, and set r to the remainder.
+        static Digit div_2by1(Digit u1, Digit u0, Digit v, Digit v_inv,
+            Digit& r)
+        {
+            const Wigit p = static_cast<Wigit>(v_inv) * u1 +
+                (static_cast<Wigit>(u1) << Unsigned::BITS | u0);
+            Digit q1 = static_cast<Digit>(p >> Unsigned::BITS) + 1;
+            const Digit q0 = static_cast<Digit>(p);
+            r = u0 - q1 * v;
+            if (r > q0)
+            {
+                --q1;
+                r += v;
+            }
+            if (r >= v)
+            {
+                ++q1;
+                r -= v;
+            }
+            return q1;
+        }
+
+        // Return quotient of u2 BASE^2 + u1 BASE + u0 divided by normalized
+        // v1 BASE + v0, with (u2, u1) < (v1, v0), and set (r1, r0) to the
+        // remainder.
+        static Digit div_3by2(Digit u2, Digit u1, Digit u0, Digit v1,
+            Digit v0, Digit v_inv, Digit& r1, Digit& r0)
+        {
+            const Wigit v = static_cast<Wigit>(v1) << Unsigned::BITS | v0;
+            const Wigit p = static_cast<Wigit>(v_inv) * u2 +
+                (static_cast<Wigit>(u2) << Unsigned::BITS | u1);
+            Digit q1 = static_cast<Digit>(p >> Unsigned::BITS);
+            const Digit q0 = static_cast<Digit>(p);
+            const Digit t1 = u1 - q1 * v1;
+            Wigit r = (static_cast<Wigit>(t1) << Unsigned::BITS | u0) -
+                static_cast<Wigit>(v0) * q1 - v;
+            ++q1;
+            if (static_cast<Digit>(r >> Unsigned::BITS) >= q0)
+            {
+                --q1;
+                r += v;
+            }
+            if (r >= v)
+            {
+                ++q1;
+                r -= v;
+            }
+            r1 = static_cast<Digit>(r >> Unsigned::BITS);
+            r0 = static_cast<Digit>(r);
+            return q1;
+        }
+
+        void divide_1(const Unsigned& u, Unsigned& q, Unsigned& r) const
+        {
+            const Unsigned w = u << shift;
+            const size_t m = w.digits.size();
+            const Digit vn = v.digits[0];
+            q.digits.resize(m);
+            Digit k = 0;
+            for (size_t j = m; j-- != 0;)
+            {
+                q.digits[j] = div_2by1(k, w.digits[j], vn, v_inv, k);
+            }
+            q.trim();
+            r = Unsigned(k >> shift);
+        }
+
+        // Knuth's Algorithm D, estimating each quotient digit from the
+        // leading three digits of the partial remainder.
+        void divide_schoolbook(const Unsigned& u, Unsigned& q,
+            Unsigned& r) const
+        {
+            r = u << shift;
+            r.digits.push_back(0);
+            const size_t m = r.digits.size();
+            q.digits.resize(m - n);
+            const Digit* vp = v.digits.data();
+            const Digit v1 = vp[n - 1];
+            const Digit v0 = vp[n - 2];
+            Unsigned w;
+            w.digits.resize(n + 1);
+            for (size_t j = m - n; j-- != 0;)
+            {
+                Digit* rp = &r.digits[j];
+                const Digit u2 = rp[n];
+                const Digit u1 = rp[n - 1];
+                Digit qj;
+                if (u2 == v1 && u1 == v0)
+                {
+                    // Quotient digit is exactly BASE - 1.
+                    qj = ~static_cast<Digit>(0);
+                    w.digits[n] = Unsigned::mul_1(w.digits.data(), vp, n, qj);
+                    Unsigned::sub_n(rp, rp, w.digits.data(), n + 1);
+                }
+                else
+                {
+                    // Subtract qj * v[0, n-2) from the low digits, given
+                    // the remainder (r1, r0) of the leading three.
+                    Digit r1, r0;
+                    qj = div_3by2(u2, u1, rp[n - 2], v1, v0, v_inv, r1, r0);
+                    Digit c = 0;
+                    if (n > 2)
+                    {
+                        c = Unsigned::mul_1(w.digits.data(), vp, n - 2, qj);
+                        c += Unsigned::sub_n(rp, rp, w.digits.data(), n - 2);
+                    }
+                    const Digit b = (r0 < c);
+                    r0 -= c;
+                    const bool is_negative = (r1 < b);
+                    r1 -= b;
+                    rp[n - 2] = r0;
+                    if (is_negative)
+                    {
+                        // Add back (v), one too many subtracted.
+                        r1 += v1 + Unsigned::add_n(rp, rp, vp, n - 1);
+                        --qj;
+                    }
+                    rp[n - 1] = r1;
+                    rp[n] = 0;
+                }
+                q.digits[j] = qj;
+            }
+
+            // Denormalize remainder.
+            q.trim();
+            r.digits.resize(n);
+            r.trim();
+            r >>= shift;
+        }
+
+        // Divide n digits of quotient at a time, using the reciprocal x.
+        void divide_newton(const Unsigned& u, Unsigned& q, Unsigned& r) const
+        {
+            const Unsigned w0 = u << shift;
+            q.digits.assign(1, 0);
+            r.digits.assign(1, 0);
+            Unsigned w, qj;
+            for (size_t j = (w0.digits.size() + n - 1) / n * n; j != 0;)
+            {
+                j -= n;
+                w = w0.slice(j, n);
+                w.add_shifted(r, n);
+
+                // Estimate quotient digits (never too large).
+                qj = ((w >> ((n - 1) * Unsigned::BITS)) * x) >>
+                    ((n + 1) * Unsigned::BITS);
+                r = w - qj * v;
+                while (r >= v)
+                {
+                    r -= v;
+                    ++qj;
+                }
+                q.add_shifted(qj, j);
+            }
+
+            // Denormalize remainder.
+            r >>= shift;
+        }
+    };
+} // namespace math
+
+#endif // MATH_DIVISOR_H
@@ -2,29 +2,48 @@
 #define MATH_INTEGER_H
 
 #include "math_Unsigned.h"
+#include <string>
+#include <new>
+#include <functional>
 
 namespace math
 {
+    // Integers with magnitude at most INT64_MAX are stored inline, with
+    // arithmetic on them in native (overflow-checked) instructions; larger
+    // values are stored as sign and Unsigned magnitude, in the same space.
     class Integer
     {
     public:
-        Integer(std::int32_t u = 0) :
-            sign((u > 0) - (u < 0)),
-            mag(u < 0 ? -u : u)
+        // Note that an unsigned argument above INT64_MAX (e.g., a size_t)
+        // converts to a negative value, as in any conversion to int64_t.
+        Integer(std::int64_t u = 0) :
+            is_small(true),
+            sign(0),
+            small(0)
         {
-            // empty
+            set_small(u);
         }
 
         Integer(const Unsigned& u) :
+            is_small(false),
             sign(u == 0 ? 0 : 1),
             mag(u)
         {
-            // empty
+            demote();
+        }
+
+        Integer(Unsigned&& u) :
+            is_small(false),
+            sign(u == 0 ? 0 : 1),
+            mag(std::move(u))
+        {
+            demote();
         }
 
         Integer(const std::string& s) :
+            is_small(true),
             sign(0),
-            mag()
+            small(0)
         {
             std::istringstream iss(s);
             iss >> *this;
@@ -35,31 +54,102 @@ namespace math
         }
 
         Integer(const Integer& copy) :
+            is_small(true),
+            sign(copy.sign),
+            small(0)
+        {
+            if (copy.is_small)
+            {
+                small = copy.small;
+            }
+            else
+            {
+                new (&mag) Unsigned(copy.mag);
+                is_small = false;
+            }
+        }
+
+        // Moved-from value is zero.
+        Integer(Integer&& copy) noexcept :
+            is_small(true),
             sign(copy.sign),
-            mag(copy.mag)
+            small(0)
         {
-            // empty
+            if (copy.is_small)
+            {
+                small = copy.small;
+            }
+            else
+            {
+                new (&mag) Unsigned(std::move(copy.mag));
+                is_small = false;
+            }
+            copy.clear();
+        }
+
+        ~Integer()
+        {
+            clear();
         }
 
         Integer& operator= (const Integer& rhs)
         {
-            sign = rhs.sign;
-            mag = rhs.mag;
+            if (this != &rhs)
+            {
+                if (rhs.is_small)
+                {
+                    clear();
+                    small = rhs.small;
+                }
+                else
+                {
+                    set_big(rhs.sign, rhs.mag);
+                }
+            }
+            return *this;
+        }
+
+        Integer& operator= (Integer&& rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                if (rhs.is_small)
+                {
+                    clear();
+                    small = rhs.small;
+                }
+                else
+                {
+                    set_big(rhs.sign, std::move(rhs.mag));
+                }
+                rhs.clear();
+            }
             return *this;
         }
 
-        Integer operator+ () const
+        Integer operator+ () const &
         {
             return *this;
         }
 
-        Integer operator- () const
+        Integer operator+ () &&
+        {
+            return std::move(*this);
+        }
+
+        Integer operator- () const &
         {
             Integer w(*this);
-            w.sign = -sign;
+            w.negate();
             return w;
         }
 
+        Integer operator- () &&
+        {
+            negate();
+            return std::move(*this);
+        }
+
         Integer operator++ (int)
         {
             Integer w(*this);
@@ -69,6 +159,12 @@ namespace math
 
         Integer& operator++ ()
         {
+            if (is_small && small < INT64_MAX)
+            {
+                ++small;
+                return *this;
+            }
+            promote();
             if (sign < 0)
             {
                 if (--mag == 0)
@@ -81,6 +177,7 @@ namespace math
                 sign = 1;
                 ++mag;
             }
+            demote();
             return *this;
         }
 
@@ -93,6 +190,12 @@ namespace math
 
         Integer& operator-- ()
         {
+            if (is_small && small > -INT64_MAX)
+            {
+                --small;
+                return *this;
+            }
+            promote();
             if (sign > 0)
             {
                 if (--mag == 0)
@@ -105,6 +208,7 @@ namespace math
                 sign = -1;
                 ++mag;
             }
+            demote();
             return *this;
         }
 
@@ -114,33 +218,47 @@ namespace math
             return u;
         }
 
+        friend Integer operator+ (const Integer& u, Integer&& v)
+        {
+            v += u;
+            return std::move(v);
+        }
+
         Integer& operator+= (const Integer& rhs)
         {
-            if (sign == 0)
+            if (is_small && rhs.is_small && add_small(small, rhs.small, small))
+            {
+                return *this;
+            }
+            if (signum() == 0)
             {
                 *this = rhs;
+                return *this;
             }
-            else if (rhs.sign != 0)
+            Unsigned t;
+            add(rhs.signum(), rhs.magnitude(t));
+            return *this;
+        }
+
+        friend Integer operator+ (Integer u, std::int64_t v)
+        {
+            u += v;
+            return u;
+        }
+
+        friend Integer operator+ (std::int64_t u, Integer v)
+        {
+            v += u;
+            return v;
+        }
+
+        Integer& operator+= (std::int64_t rhs)
+        {
+            if (is_small && add_small(small, rhs, small))
             {
-                if (sign == rhs.sign)
-                {
-                    mag += rhs.mag;
-                }
-                else if (rhs.mag < mag)
-                {
-                    mag -= rhs.mag;
-                }
-                else if (rhs.mag == mag)
-                {
-                    sign = 0;
-                    mag = 0;
-                }
-                else
-                {
-                    sign = rhs.sign;
-                    mag = rhs.mag - mag;
-                }
+                return *this;
             }
+            add((rhs > 0) - (rhs < 0), to_unsigned(to_uint64(rhs)));
             return *this;
         }
 
@@ -149,22 +267,108 @@ namespace math
             return u + (-v);
         }
 
+        friend Integer operator- (const Integer& u, Integer&& v)
+        {
+            v.negate();
+            v += u;
+            return std::move(v);
+        }
+
         Integer& operator-= (const Integer& rhs)
         {
             *this += -rhs;
             return *this;
         }
 
-        friend Integer operator* (Integer u, const Integer& v)
+        friend Integer operator- (Integer u, std::int64_t v)
         {
-            u *= v;
+            u -= v;
             return u;
         }
 
+        friend Integer operator- (std::int64_t u, Integer v)
+        {
+            v.negate();
+            v += u;
+            return v;
+        }
+
+        Integer& operator-= (std::int64_t rhs)
+        {
+            if (is_small && rhs != INT64_MIN && add_small(small, -rhs, small))
+            {
+                return *this;
+            }
+            add((rhs < 0) - (rhs > 0), to_unsigned(to_uint64(rhs)));
+            return *this;
+        }
+
+        friend Integer operator* (const Integer& u, const Integer& v)
+        {
+            Integer w;
+            if (u.is_small && v.is_small &&
+                mul_small(u.small, v.small, w.small))
+            {
+                return w;
+            }
+            Unsigned s, t;
+            w.set_big(u.signum() * v.signum(), u.magnitude(s) * v.magnitude(t));
+            w.demote();
+            return w;
+        }
+
+        friend Integer operator* (const Integer& u, Integer&& v)
+        {
+            v *= u;
+            return std::move(v);
+        }
+
         Integer& operator*= (const Integer& rhs)
         {
-            sign *= rhs.sign;
-            mag *= rhs.mag;
+            if (is_small && rhs.is_small && mul_small(small, rhs.small, small))
+            {
+                return *this;
+            }
+            const std::int32_t rhs_sign = rhs.signum();
+            Unsigned t;
+            const Unsigned& v = rhs.magnitude(t);
+            promote();
+            sign *= rhs_sign;
+            mag *= v;
+            demote();
+            return *this;
+        }
+
+        friend Integer operator* (Integer u, std::int64_t v)
+        {
+            u *= v;
+            return u;
+        }
+
+        friend Integer operator* (std::int64_t u, Integer v)
+        {
+            v *= u;
+            return v;
+        }
+
+        Integer& operator*= (std::int64_t rhs)
+        {
+            if (is_small && mul_small(small, rhs, small))
+            {
+                return *this;
+            }
+            promote();
+            sign *= (rhs > 0) - (rhs < 0);
+            const std::uint64_t v = to_uint64(rhs);
+            if (is_digit(v))
+            {
+                mag *= static_cast<Unsigned::Digit>(v);
+            }
+            else
+            {
+                mag *= to_unsigned(v);
+            }
+            demote();
             return *this;
         }
 
@@ -176,12 +380,35 @@ namespace math
 
         Integer& operator/= (const Integer& rhs)
         {
-            sign *= rhs.sign;
-            mag /= rhs.mag;
+            if (is_small && rhs.is_small && rhs.small != 0)
+            {
+                small /= rhs.small;
+                return *this;
+            }
+            const std::int32_t rhs_sign = rhs.signum();
+            Unsigned t;
+            const Unsigned& v = rhs.magnitude(t);
+            promote();
+            sign *= rhs_sign;
+            mag /= v;
             if (mag == 0)
             {
                 sign = 0;
             }
+            demote();
+            return *this;
+        }
+
+        friend Integer operator/ (Integer u, std::int64_t v)
+        {
+            u /= v;
+            return u;
+        }
+
+        Integer& operator/= (std::int64_t rhs)
+        {
+            std::int64_t r;
+            divide(rhs, *this, r);
             return *this;
         }
 
@@ -193,14 +420,88 @@ namespace math
 
         Integer& operator%= (const Integer& rhs)
         {
-            mag %= rhs.mag;
+            if (is_small && rhs.is_small && rhs.small != 0)
+            {
+                small %= rhs.small;
+                return *this;
+            }
+            Unsigned t;
+            const Unsigned& v = rhs.magnitude(t);
+            promote();
+            mag %= v;
             if (mag == 0)
             {
                 sign = 0;
             }
+            demote();
             return *this;
         }
 
+        friend Integer operator% (const Integer& u, std::int64_t v)
+        {
+            return Integer(u.mod_word(v));
+        }
+
+        Integer& operator%= (std::int64_t rhs)
+        {
+            set_small(mod_word(rhs));
+            return *this;
+        }
+
+        // Return this % v (truncating, as %) as a word.
+        std::int64_t mod_word(std::int64_t v) const
+        {
+            if (is_small && v != 0)
+            {
+                return small % v;
+            }
+            Unsigned t;
+            const Unsigned& m = magnitude(t);
+            const std::uint64_t w = to_uint64(v);
+            const std::uint64_t r = is_digit(w) ?
+                m.mod_word(static_cast<Unsigned::Digit>(w)) :
+                to_uint64(m % to_unsigned(w));
+            return (signum() < 0) ? -static_cast<std::int64_t>(r) :
+                static_cast<std::int64_t>(r);
+        }
+
+        // Compute q = this / v and r = this % v, truncating as / and %.
+        void divide(std::int64_t v, Integer& q, std::int64_t& r) const
+        {
+            if (is_small && v != 0)
+            {
+                const std::int64_t u = small;
+                q.set_small(u / v);
+                r = u % v;
+                return;
+            }
+            const std::int32_t u_sign = signum();
+            q = *this;
+            q.promote();
+            const std::uint64_t w = to_uint64(v);
+            std::uint64_t m;
+            if (is_digit(w))
+            {
+                Unsigned::Digit d;
+                q.mag.divide(static_cast<Unsigned::Digit>(w), q.mag, d);
+                m = d;
+            }
+            else
+            {
+                Unsigned t;
+                q.mag.divide(to_unsigned(w), q.mag, t);
+                m = to_uint64(t);
+            }
+            r = (u_sign < 0) ? -static_cast<std::int64_t>(m) :
+                static_cast<std::int64_t>(m);
+            q.sign *= (v > 0) - (v < 0);
+            if (q.mag == 0)
+            {
+                q.sign = 0;
+            }
+            q.demote();
+        }
+
         friend Integer operator<< (Integer u, size_t v)
         {
             u <<= v;
@@ -209,7 +510,14 @@ namespace math
 
         Integer& operator<<= (size_t rhs)
         {
+            if (is_small && rhs < 63 && (to_uint64(small) >> (63 - rhs)) == 0)
+            {
+                small *= static_cast<std::int64_t>(1) << rhs;
+                return *this;
+            }
+            promote();
             mag <<= rhs;
+            demote();
             return *this;
         }
 
@@ -221,11 +529,19 @@ namespace math
 
         Integer& operator>>= (size_t rhs)
         {
+            if (is_small)
+            {
+                const std::int64_t w = (rhs < 64) ?
+                    static_cast<std::int64_t>(to_uint64(small) >> rhs) : 0;
+                small = (small < 0) ? -w : w;
+                return *this;
+            }
             mag >>= rhs;
             if (mag == 0)
             {
                 sign = 0;
             }
+            demote();
             return *this;
         }
 
@@ -241,33 +557,20 @@ namespace math
             return u;
         }
 
-        Integer& operator&= (Integer rhs)
+        friend Integer operator& (const Integer& u, Integer&& v)
         {
-            if (sign < 0 && rhs.sign < 0)
-            {
-                // -u & -v == -((u-1) | (v-1) + 1)
-                --mag;
-                mag |= --rhs.mag;
-                ++mag;
-            }
-            else
+            v &= u;
+            return std::move(v);
+        }
+
+        Integer& operator&= (const Integer& rhs)
+        {
+            if (is_small && rhs.is_small)
             {
-                if (sign > 0 && rhs.sign < 0)
-                {
-                    // u & -v == u & ~(v-1)
-                    mag = mag.and_not(--rhs.mag);
-                }
-                else if (sign < 0 && rhs.sign > 0)
-                {
-                    --mag;
-                    mag = rhs.mag.and_not(mag);
-                }
-                else
-                {
-                    mag &= rhs.mag;
-                }
-                sign = (mag == 0 ? 0 : 1);
+                set_small(small & rhs.small);
+                return *this;
             }
+            bitwise(rhs, std::bit_and<Unsigned::Digit>());
             return *this;
         }
 
@@ -277,37 +580,20 @@ namespace math
             return u;
         }
 
-        Integer& operator^= (Integer rhs)
+        friend Integer operator^ (const Integer& u, Integer&& v)
         {
-            if (sign < 0 && rhs.sign < 0)
-            {
-                // -u ^ -v == (u-1) ^ (v-1)
-                --mag;
-                mag ^= --rhs.mag;
-                sign = (mag == 0 ? 0 : 1);
-            }
-            else if (sign > 0 && rhs.sign < 0)
-            {
-                // u ^ -v == -(u ^ (v-1) + 1)
-                sign = -1;
-                mag ^= --rhs.mag;
-                ++mag;
-            }
-            else if (sign < 0 && rhs.sign > 0)
-            {
-                --mag;
-                mag ^= rhs.mag;
-                ++mag;
-            }
-            else
+            v ^= u;
+            return std::move(v);
+        }
+
+        Integer& operator^= (const Integer& rhs)
+        {
+            if (is_small && rhs.is_small)
             {
-                sign |= rhs.sign;
-                mag ^= rhs.mag;
-                if (mag == 0)
-                {
-                    sign = 0;
-                }
+                set_small(small ^ rhs.small);
+                return *this;
             }
+            bitwise(rhs, std::bit_xor<Unsigned::Digit>());
             return *this;
         }
 
@@ -317,41 +603,42 @@ namespace math
             return u;
         }
 
-        Integer& operator|= (Integer rhs)
+        friend Integer operator| (const Integer& u, Integer&& v)
+        {
+            v |= u;
+            return std::move(v);
+        }
+
+        Integer& operator|= (const Integer& rhs)
         {
-            if (sign < 0 && rhs.sign < 0)
+            if (is_small && rhs.is_small)
             {
-                // -u | -v == -((u-1) & (v-1) + 1)
-                --mag;
-                mag &= --rhs.mag;
-                ++mag;
+                set_small(small | rhs.small);
+                return *this;
             }
-            else if (sign > 0 && rhs.sign < 0)
+            bitwise(rhs, std::bit_or<Unsigned::Digit>());
+            return *this;
+        }
+
+        friend bool operator< (const Integer& u, const Integer& v)
+        {
+            if (u.is_small && v.is_small)
             {
-                // u | -v == -((v-1) & ~u + 1)
-                sign = -1;
-                --rhs.mag;
-                mag = rhs.mag.and_not(mag);
-                ++mag;
+                return u.small < v.small;
             }
-            else if (sign < 0 && rhs.sign > 0)
+            const std::int32_t u_sign = u.signum();
+            const std::int32_t v_sign = v.signum();
+            if (u_sign != v_sign)
             {
-                --mag;
-                mag = mag.and_not(rhs.mag);
-                ++mag;
+                return u_sign < v_sign;
             }
-            else
+
+            // Same sign, and at least one magnitude exceeds INT64_MAX.
+            if (u.is_small != v.is_small)
             {
-                sign |= rhs.sign;
-                mag |= rhs.mag;
+                return (u.is_small == (u_sign > 0));
             }
-            return *this;
-        }
-
-        friend bool operator< (const Integer& u, const Integer& v)
-        {
-            return (u.sign < v.sign || (u.sign == v.sign &&
-                ((u.sign < 0) ? (v.mag < u.mag) : (u.mag < v.mag))));
+            return (u_sign < 0) ? (v.mag < u.mag) : (u.mag < v.mag);
         }
 
         friend bool operator> (const Integer& u, const Integer& v)
@@ -371,22 +658,173 @@ namespace math
 
         friend bool operator== (const Integer& u, const Integer& v)
         {
+            if (u.is_small || v.is_small)
+            {
+                return (u.is_small == v.is_small && u.small == v.small);
+            }
             return (u.sign == v.sign && u.mag == v.mag);
         }
 
         friend bool operator!= (const Integer& u, const Integer& v)
         {
-            return (u.sign != v.sign || u.mag != v.mag);
+            return !(u == v);
+        }
+
+        friend bool operator< (const Integer& u, std::int64_t v)
+        {
+            return (u.compare(v) < 0);
+        }
+
+        friend bool operator< (std::int64_t u, const Integer& v)
+        {
+            return (v.compare(u) > 0);
+        }
+
+        friend bool operator> (const Integer& u, std::int64_t v)
+        {
+            return (u.compare(v) > 0);
+        }
+
+        friend bool operator> (std::int64_t u, const Integer& v)
+        {
+            return (v.compare(u) < 0);
+        }
+
+        friend bool operator<= (const Integer& u, std::int64_t v)
+        {
+            return (u.compare(v) <= 0);
+        }
+
+        friend bool operator<= (std::int64_t u, const Integer& v)
+        {
+            return (v.compare(u) >= 0);
+        }
+
+        friend bool operator>= (const Integer& u, std::int64_t v)
+        {
+            return (u.compare(v) >= 0);
+        }
+
+        friend bool operator>= (std::int64_t u, const Integer& v)
+        {
+            return (v.compare(u) <= 0);
+        }
+
+        friend bool operator== (const Integer& u, std::int64_t v)
+        {
+            return (u.compare(v) == 0);
+        }
+
+        friend bool operator== (std::int64_t u, const Integer& v)
+        {
+            return (v.compare(u) == 0);
+        }
+
+        friend bool operator!= (const Integer& u, std::int64_t v)
+        {
+            return (u.compare(v) != 0);
+        }
+
+        friend bool operator!= (std::int64_t u, const Integer& v)
+        {
+            return (v.compare(u) != 0);
         }
 
         std::int32_t signum() const
         {
-            return sign;
+            return is_small ? (small > 0) - (small < 0) : sign;
         }
 
         Unsigned abs() const
         {
-            return mag;
+            return is_small ? to_unsigned(to_uint64(small)) : mag;
+        }
+
+        // Bit k of two's complement representation (with infinite sign
+        // extension for negative values).
+        bool test_bit(size_t k) const
+        {
+            if (is_small)
+            {
+                return (k < 63) ?
+                    ((static_cast<std::uint64_t>(small) >> k) & 1) != 0 :
+                    (small < 0);
+            }
+            if (sign >= 0)
+            {
+                return mag.test_bit(k);
+            }
+
+            // Bits of -m below its lowest 1 bit are those of m, and above
+            // are those of ~m.
+            const size_t z = mag.lowest_set_bit();
+            return (k == z || (k > z && !mag.test_bit(k)));
+        }
+
+        void set_bit(size_t k)
+        {
+            if (test_bit(k))
+            {
+                return;
+            }
+            if (is_small && k < 63)
+            {
+                small += static_cast<std::int64_t>(1) << k;
+                return;
+            }
+            promote();
+            if (sign < 0)
+            {
+                mag.sub_bit(k);
+            }
+            else
+            {
+                sign = 1;
+                mag.set_bit(k);
+            }
+            demote();
+        }
+
+        void clear_bit(size_t k)
+        {
+            if (!test_bit(k))
+            {
+                return;
+            }
+            if (is_small && k < 63)
+            {
+                set_small(small - (static_cast<std::int64_t>(1) << k));
+                return;
+            }
+            promote();
+            if (sign < 0)
+            {
+                mag.add_bit(k);
+            }
+            else
+            {
+                mag.clear_bit(k);
+                if (mag == 0)
+                {
+                    sign = 0;
+                }
+            }
+            demote();
+        }
+
+        // Return number of 1 bits in abs().
+        size_t popcount() const
+        {
+            Unsigned t;
+            return magnitude(t).popcount();
+        }
+
+        // Return index of least significant 1 bit (the same for u and -u),
+        // or 0 for u == 0.
+        size_t lowest_set_bit() const
+        {
+            Unsigned t;
+            return magnitude(t).lowest_set_bit();
         }
 
         std::string to_string() const
@@ -398,11 +836,18 @@ namespace math
 
         friend std::ostream& operator<< (std::ostream& os, const Integer& u)
         {
-            if (u.sign < 0)
+            if (u.signum() < 0)
             {
                 os << "-";
             }
-            os << u.mag;
+            if (u.is_small)
+            {
+                os << std::to_string(to_uint64(u.small));
+            }
+            else
+            {
+                os << u.mag;
+            }
             return os;
         }
 
@@ -420,12 +865,11 @@ namespace math
                 if ((sign_ch == '+' || sign_ch == '-') &&
                     std::isdigit(is.peek()))
                 {
-                    is >> u.mag;
-                    u.sign = (sign_ch == '-' ? -1 : 1);
-                    if (u.mag == 0)
-                    {
-                        u.sign = 0;
-                    }
+                    Unsigned m;
+                    is >> m;
+                    u.set_big(m == 0 ? 0 : (sign_ch == '-' ? -1 : 1),
+                        std::move(m));
+                    u.demote();
                 }
                 else
                 {
@@ -440,8 +884,272 @@ namespace math
         }
 
     private:
+        friend class Rational;
+
+        // Either small holds the value, or sign and mag hold it with
+        // mag > INT64_MAX; only the member selected by is_small is alive.
+        bool is_small;
         std::int32_t sign;
-        Unsigned mag;
+        union
+        {
+            std::int64_t small;
+            Unsigned mag;
+        };
+
+        static std::uint64_t to_uint64(std::int64_t u)
+        {
+            return (u < 0) ? 0 - static_cast<std::uint64_t>(u) :
+                static_cast<std::uint64_t>(u);
+        }
+
+        static std::uint64_t to_uint64(const Unsigned& u)
+        {
+            std::uint64_t w = u.digits[0];
+#ifndef MATH_DIGIT64
+            if (u.digits.size() > 1)
+            {
+                w |= static_cast<std::uint64_t>(u.digits[1]) << 32;
+            }
+#endif
+            return w;
+        }
+
+        static bool is_digit(std::uint64_t u)
+        {
+            return (u <= static_cast<Unsigned::Digit>(-1));
+        }
+
+        static Unsigned to_unsigned(std::uint64_t u)
+        {
+            Unsigned w(static_cast<Unsigned::Digit>(u));
+#ifndef MATH_DIGIT64
+            if ((u >> 32) != 0)
+            {
+                w.digits.push_back(static_cast<Unsigned::Digit>(u >> 32));
+            }
+#endif
+            return w;
+        }
+
+        // Compute w = u + v, and return true if |w| <= INT64_MAX.
+        static bool add_small(std::int64_t u, std::int64_t v,
+            std::int64_t& w)
+        {
+            std::int64_t t;
+#if defined(__GNUC__)
+            if (__builtin_add_overflow(u, v, &t))
+            {
+                return false;
+            }
+#else
+            if ((v > 0 && u > INT64_MAX - v) || (v < 0 && u < INT64_MIN - v))
+            {
+                return false;
+            }
+            t = u + v;
+#endif
+            if (t == INT64_MIN)
+            {
+                return false;
+            }
+            w = t;
+            return true;
+        }
+
+        // Compute w = u * v, and return true if |w| <= INT64_MAX.
+        static bool mul_small(std::int64_t u, std::int64_t v,
+            std::int64_t& w)
+        {
+            std::int64_t t;
+#if defined(__GNUC__)
+            if (__builtin_mul_overflow(u, v, &t))
+            {
+                return false;
+            }
+#else
+            if (u != 0 && to_uint64(v) > INT64_MAX / to_uint64(u))
+            {
+                return false;
+            }
+            t = u * v;
+#endif
+            if (t == INT64_MIN)
+            {
+                return false;
+            }
+            w = t;
+            return true;
+        }
+
+        // Set this = 0, releasing any storage held by mag.
+        void clear() noexcept
+        {
+            if (!is_small)
+            {
+                mag.~Unsigned();
+                is_small = true;
+            }
+            small = 0;
+        }
+
+        // Set this = u.
+        void set_small(std::int64_t u)
+        {
+            if (u == INT64_MIN)
+            {
+                set_big(-1, to_unsigned(to_uint64(u)));
+            }
+            else
+            {
+                clear();
+                small = u;
+            }
+        }
+
+        // Set sign and magnitude, without demoting to an inline value.
+        template<typename U>
+        void set_big(std::int32_t s, U&& m)
+        {
+            if (is_small)
+            {
+                new (&mag) Unsigned(std::forward<U>(m));
+                is_small = false;
+            }
+            else
+            {
+                mag = std::forward<U>(m);
+            }
+            sign = s;
+        }
+
+        void negate()
+        {
+            if (is_small)
+            {
+                small = -small;
+            }
+            else
+            {
+                sign = -sign;
+            }
+        }
+
+        // Set this = this op rhs in two's complement, in a single pass that
+        // complements negative operands and result with carry on the fly.
+        template<typename Op>
+        void bitwise(const Integer& rhs, Op op)
+        {
+            typedef Unsigned::Digit Digit;
+            Unsigned t;
+            const Unsigned& v = rhs.magnitude(t);
+            const Digit u_neg = (signum() < 0);
+            const Digit v_neg = (rhs.signum() < 0);
+            const Digit w_neg = op(static_cast<Digit>(0 - u_neg),
+                static_cast<Digit>(0 - v_neg)) & 1;
+            const size_t n = v.digits.size();
+            promote();
+            const size_t m = std::max(mag.digits.size(), n) + 1;
+            mag.digits.resize(m, 0);
+            Digit cu = u_neg;
+            Digit cv = v_neg;
+            Digit cw = w_neg;
+            for (size_t j = 0; j < m; ++j)
+            {
+                const Digit x = (mag.digits[j] ^ (0 - u_neg)) + cu;
+                cu &= (x == 0);
+                const Digit y = ((j < n ? v.digits[j] : 0) ^ (0 - v_neg)) +
+                    cv;
+                cv &= (y == 0);
+                const Digit w = (op(x, y) ^ (0 - w_neg)) + cw;
+                cw &= (w == 0);
+                mag.digits[j] = w;
+            }
+            mag.trim();
+            sign = (w_neg != 0) ? -1 : (mag == 0 ? 0 : 1);
+            demote();
+        }
+
+        // Add v_sign * v to this.
+        void add(std::int32_t v_sign, const Unsigned& v)
+        {
+            if (v_sign == 0)
+            {
+                return;
+            }
+            promote();
+            if (sign == 0 || sign == v_sign)
+            {
+                sign = v_sign;
+                mag += v;
+            }
+            else if (v < mag)
+            {
+                mag -= v;
+            }
+            else if (v == mag)
+            {
+                sign = 0;
+                mag = 0;
+            }
+            else
+            {
+                sign = v_sign;
+                mag = v - mag;
+            }
+            demote();
+        }
+
+        // Return -1, 0, or 1 as this is less than, equal to, or greater
+        // than v; any non-inline value has magnitude at least 2^63.
+        int compare(std::int64_t v) const
+        {
+            if (is_small)
+            {
+                return (small > v) - (small < v);
+            }
+            if (sign < 0 && v == INT64_MIN && mag == to_unsigned(to_uint64(v)))
+            {
+                return 0;
+            }
+            return sign;
+        }
+
+        // Return magnitude, in t if it is not already stored in mag.
+        const Unsigned& magnitude(Unsigned& t) const
+        {
+            if (is_small)
+            {
+                t = to_unsigned(to_uint64(small));
+                return t;
+            }
+            return mag;
+        }
+
+        // Convert to sign and magnitude.
+        void promote()
+        {
+            if (is_small)
+            {
+                set_big((small > 0) - (small < 0),
+                    to_unsigned(to_uint64(small)));
+            }
+        }
+
+        // Convert to inline value if magnitude is at most INT64_MAX,
+        // releasing the storage held by mag.
+        void demote()
+        {
+            if (is_small || mag.digits.size() > 64 / Unsigned::BITS)
+            {
+                return;
+            }
+            const std::uint64_t u = to_uint64(mag);
+            if (u <= INT64_MAX)
+            {
+                set_small((sign < 0) ? -static_cast<std::int64_t>(u) :
+                    static_cast<std::int64_t>(u));
+            }
+        }
     };
 } // namespace math
 
@@ -0,0 +1,282 @@
+#ifndef MATH_MODCONTEXT_H
+#define MATH_MODCONTEXT_H
+
+#include "math_Unsigned.h"
+
+namespace math
+{
+    // Arithmetic modulo a fixed modulus m, with constants precomputed once.
+    // Odd moduli use Montgomery form, x R mod m with R = 2^(BITS n) for an
+    // n-digit modulus; even moduli fall back to Barrett reduction.  Values
+    // passed to mul(), sqr(), and pow() must be in this internal form, i.e.,
+    // converted by encode() and back by decode().
+    class ModContext
+    {
+    public:
+        typedef Unsigned::Digit Digit;
+
+        explicit ModContext(const Unsigned& modulus) :
+            m(modulus),
+            n(modulus.digits.size()),
+            is_montgomery((modulus.digits[0] & 1) != 0),
+            m_inv(0),
+            m_prime(),
+            mu(),
+            r2(),
+            unit()
+        {
+            if (m == 0)
+            {
+                throw std::overflow_error("Error: ModContext::overflow");
+            }
+            if (is_montgomery)
+            {
+                // Compute m^-1 mod 2^BITS by Newton iteration; m is its own
+                // inverse mod 8, and each step doubles the correct bits.
+                Digit x = m.digits[0];
+                for (unsigned bits = 3; bits < Unsigned::BITS; bits *= 2)
+                {
+                    x *= 2 - m.digits[0] * x;
+                }
+                m_inv = 0 - x;
+                if (n >= REDC_THRESHOLD)
+                {
+                    // Lift -m^-1 to n digits: if m y = -1 + e, then
+                    // m y (2 + m y) = -1 + e^2.
+                    m_prime = m_inv;
+                    for (size_t k = 1; k < n; k *= 2)
+                    {
+                        m_prime = low(m_prime *
+                            low(2 + low(m * m_prime, n), n), n);
+                    }
+                }
+                unit = (Unsigned(1) << (Unsigned::BITS * n)) % m;
+                r2 = (Unsigned(1) << (2 * Unsigned::BITS * n)) % m;
+            }
+            else
+            {
+                mu = (Unsigned(1) << (2 * Unsigned::BITS * n)) / m;
+                unit = Unsigned(1) % m;
+            }
+        }
+
+        const Unsigned& modulus() const
+        {
+            return m;
+        }
+
+        // Return internal form of a mod m.
+        Unsigned encode(const Unsigned& a) const
+        {
+            if (is_montgomery)
+            {
+                return redc(r2 * (a < m ? a : a % m));
+            }
+            return a < m ? a : a % m;
+        }
+
+        // Return the residue represented by internal form a.
+        Unsigned decode(const Unsigned& a) const
+        {
+            return is_montgomery ? redc(a) : a;
+        }
+
+        // Return internal form of 1.
+        const Unsigned& one() const
+        {
+            return unit;
+        }
+
+        // Return a b, for a and b in internal form.
+        Unsigned mul(const Unsigned& a, const Unsigned& b) const
+        {
+            return reduce(a * b);
+        }
+
+        // Return a^2, for a in internal form.
+        Unsigned sqr(const Unsigned& a) const
+        {
+            return reduce(a.square());
+        }
+
+        // Return a^e, for a in internal form, by left-to-right sliding
+        // window exponentiation with a table of odd powers of a.
+        Unsigned pow(const Unsigned& a, const Unsigned& e) const
+        {
+            const int bits = e == 0 ? 0 : e.bits();
+            if (bits == 0)
+            {
+                return unit;
+            }
+            int width = 1;
+            while (width < MAX_WINDOW && bits > window_bits(width))
+            {
+                ++width;
+            }
+            std::vector<Unsigned> table(size_t(1) << (width - 1));
+            table[0] = a;
+            if (table.size() > 1)
+            {
+                const Unsigned a2 = sqr(a);
+                for (size_t j = 1; j < table.size(); ++j)
+                {
+                    table[j] = mul(table[j - 1], a2);
+                }
+            }
+            Unsigned w = unit;
+            bool is_one = true;
+            for (int i = bits - 1; i >= 0;)
+            {
+                if (!e.test_bit(i))
+                {
+                    if (!is_one)
+                    {
+                        w = sqr(w);
+                    }
+                    --i;
+                    continue;
+                }
+
+                // Find the longest window e[j..i] of at most width bits
+                // ending in a 1 bit.
+                int j = std::max(i - width + 1, 0);
+                while (!e.test_bit(j))
+                {
+                    ++j;
+                }
+                size_t v = 0;
+                for (int k = i; k >= j; --k)
+                {
+                    v = 2 * v + (e.test_bit(k) ? 1 : 0);
+                }
+                if (is_one)
+                {
+                    w = table[v / 2];
+                    is_one = false;
+                }
+                else
+                {
+                    for (int k = i; k >= j; --k)
+                    {
+                        w = sqr(w);
+                    }
+                    w = mul(w, table[v / 2]);
+                }
+                i = j - 1;
+            }
+            return w;
+        }
+
+    private:
+        Unsigned m;
+        size_t n;
+        bool is_montgomery;
+        Digit m_inv;
+        Unsigned m_prime;
+        Unsigned mu;
+        Unsigned r2;
+        Unsigned unit;
+
+        // Moduli with at least this many digits use multiplication-based
+        // Montgomery reduction instead of digit-by-digit.
+        static const size_t REDC_THRESHOLD = 80;
+
+        // Largest sliding window width.
+        static const int MAX_WINDOW = 7;
+
+        // Return exponent size (in bits) above which a window wider than
+        // the given width is worth its larger table of odd powers.
+        static int window_bits(int width)
+        {
+            static const int limit[MAX_WINDOW - 1] = {
+                7, 25, 81, 241, 673, 1793
+            };
+            return limit[width - 1];
+        }
+
+        // Return u mod 2^(BITS k).
+        static Unsigned low(const Unsigned& u, size_t k)
+        {
+            if (u.digits.size() <= k)
+            {
+                return u;
+            }
+            Unsigned w;
+            w.digits.assign(u.digits.begin(), u.digits.begin() + k);
+            w.trim();
+            return w;
+        }
+
+        // Return t mod m, for t < m^2.
+        Unsigned reduce(const Unsigned& t) const
+        {
+            return is_montgomery ? redc(t) : barrett(t);
+        }
+
+        // Return t R^-1 mod m, for t < m R.
+        Unsigned redc(Unsigned t) const
+        {
+            if (n >= REDC_THRESHOLD)
+            {
+                Unsigned w = (t + low(low(t, n) * m_prime, n) * m) >>
+                    (Unsigned::BITS * n);
+                if (w >= m)
+                {
+                    w -= m;
+                }
+                return w;
+            }
+
+            // Each step clears the low digit of t by adding a multiple of
+            // m, and saves the carry in the cleared digit.
+            t.digits.resize(2 * n, 0);
+            Digit* tp = t.digits.data();
+            const Digit* mp = m.digits.data();
+            for (size_t i = 0; i < n; ++i)
+            {
+                tp[i] = Unsigned::addmul_1(tp + i, mp, n, tp[i] * m_inv);
+            }
+            Unsigned w;
+            w.digits.resize(n);
+            Digit* wp = w.digits.data();
+            if (Unsigned::add_n(wp, tp + n, tp, n) != 0)
+            {
+                Unsigned::sub_n(wp, wp, mp, n);
+                w.trim();
+            }
+            else
+            {
+                w.trim();
+                if (w >= m)
+                {
+                    w -= m;
+                }
+            }
+            return w;
+        }
+
+        // Return t mod m, for t < 2^(2 BITS n), using the precomputed
+        // mu = floor(2^(2 BITS n) / m).
+        Unsigned barrett(const Unsigned& t) const
+        {
+            const Unsigned q = ((t >> (Unsigned::BITS * (n - 1))) * mu) >>
+                (Unsigned::BITS * (n + 1));
+            Unsigned r = t - q * m;
+            while (r >= m)
+            {
+                r -= m;
+            }
+            return r;
+        }
+    };
+
+    // Return a^e mod m.
+    inline Unsigned modpow(const Unsigned& a, const Unsigned& e,
+        const Unsigned& m)
+    {
+        const ModContext context(m);
+        return context.decode(context.pow(context.encode(a), e));
+    }
+} // namespace math
+
+#endif // MATH_MODCONTEXT_H
@@ -0,0 +1,219 @@
+#ifndef MATH_PRODUCT_H
+#define MATH_PRODUCT_H
+
+#include "math_Unsigned.h"
+
+namespace math
+{
+    // Return the product of the values in [first, last), multiplying adjacent
+    // pairs in a balanced tree so that large products are of similar size.
+    template<typename Iterator>
+    Unsigned product(Iterator first, Iterator last)
+    {
+        std::vector<Unsigned> w(first, last);
+        if (w.empty())
+        {
+            return 1;
+        }
+        while (w.size() > 1)
+        {
+            size_t m = 0;
+            for (size_t i = 0; i + 1 < w.size(); i += 2)
+            {
+                w[m++] = w[i] * w[i + 1];
+            }
+            if (w.size() % 2 != 0)
+            {
+                w[m++] = std::move(w.back());
+            }
+            w.resize(m);
+        }
+        return std::move(w[0]);
+    }
+
+    template<typename Range>
+    Unsigned product(const Range& r)
+    {
+        return product(r.begin(), r.end());
+    }
+
+    // Return the levels of a product tree of m, from tree[0] = m up to the
+    // root tree.back() = {product(m)}; each node is the product of two
+    // adjacent nodes below, with an odd last node carried up unchanged.
+    inline std::vector<std::vector<Unsigned> > product_tree(
+        const std::vector<Unsigned>& m)
+    {
+        std::vector<std::vector<Unsigned> > tree(1, m);
+        while (tree.back().size() > 1)
+        {
+            const std::vector<Unsigned>& w = tree.back();
+            std::vector<Unsigned> next((w.size() + 1) / 2);
+            for (size_t i = 0; i + 1 < w.size(); i += 2)
+            {
+                next[i / 2] = w[i] * w[i + 1];
+            }
+            if (w.size() % 2 != 0)
+            {
+                next.back() = w.back();
+            }
+            tree.push_back(std::move(next));
+        }
+        return tree;
+    }
+
+    // Return u mod each leaf of a (non-empty) product tree, by reducing u
+    // modulo the root, then each remainder modulo the two children of its
+    // node, down to the leaves.
+    inline std::vector<Unsigned> remainders(const Unsigned& u,
+        const std::vector<std::vector<Unsigned> >& tree)
+    {
+        std::vector<Unsigned> r(1, u);
+        for (size_t k = tree.size(); k-- != 0;)
+        {
+            const std::vector<Unsigned>& w = tree[k];
+            std::vector<Unsigned> next(w.size());
+            for (size_t i = 0; i < w.size(); ++i)
+            {
+                const Unsigned& v = r[i / 2];
+                next[i] = (v < w[i]) ? v : v % w[i];
+            }
+            r.swap(next);
+        }
+        return r;
+    }
+
+    // Return u mod m[i] for each modulus m[i], using a remainder tree.
+    inline std::vector<Unsigned> remainders(const Unsigned& u,
+        const std::vector<Unsigned>& m)
+    {
+        return m.empty() ? m : remainders(u, product_tree(m));
+    }
+
+    // Return the primes p <= n, by sieve of Eratosthenes.
+    inline std::vector<Unsigned::Digit> primes(Unsigned::Digit n)
+    {
+        std::vector<Unsigned::Digit> p;
+        if (n < 2)
+        {
+            return p;
+        }
+        std::vector<bool> is_composite;
+        if (static_cast<size_t>(n) >= is_composite.max_size())
+        {
+            throw std::length_error("Error: primes::length");
+        }
+        is_composite.assign(static_cast<size_t>(n) + 1, false);
+        for (Unsigned::Digit k = 2; k <= n / k; ++k)
+        {
+            if (!is_composite[k])
+            {
+                for (Unsigned::Digit j = k; j <= n / k; ++j)
+                {
+                    is_composite[j * k] = true;
+                }
+            }
+        }
+
+        // Collect primes, stopping at k == n (since ++k may wrap).
+        for (Unsigned::Digit k = 2;; ++k)
+        {
+            if (!is_composite[k])
+            {
+                p.push_back(k);
+            }
+            if (k == n)
+            {
+                break;
+            }
+        }
+        return p;
+    }
+
+    // Return the product of p[i]^e[i], computed from the most significant bit
+    // of the exponents down, by squaring and multiplying by the product of the
+    // primes whose exponents have that bit set.
+    inline Unsigned product_of_powers(const std::vector<Unsigned::Digit>& p,
+        const std::vector<Unsigned::Digit>& e)
+    {
+        Unsigned::Digit max_e = 0;
+        for (size_t i = 0; i < e.size(); ++i)
+        {
+            max_e = std::max(max_e, e[i]);
+        }
+        int bit = 0;
+        while (bit + 1 < static_cast<int>(Unsigned::BITS) &&
+            (max_e >> (bit + 1)) != 0)
+        {
+            ++bit;
+        }
+        Unsigned r = 1;
+        std::vector<Unsigned::Digit> factors;
+        for (; bit >= 0; --bit)
+        {
+            r = r.square();
+            factors.clear();
+            for (size_t i = 0; i < p.size(); ++i)
+            {
+                if ((e[i] >> bit) & 1)
+                {
+                    factors.push_back(p[i]);
+                }
+            }
+            if (!factors.empty())
+            {
+                r *= product(factors);
+            }
+        }
+        return r;
+    }
+
+    // Return n!, by prime power decomposition, with the exponent of each prime
+    // p given by sum_{i>0} floor(n/p^i).
+    inline Unsigned factorial(Unsigned::Digit n)
+    {
+        std::vector<Unsigned::Digit> p = primes(n);
+        std::vector<Unsigned::Digit> e(p.size(), 0);
+        for (size_t i = 0; i < p.size(); ++i)
+        {
+            for (Unsigned::Digit q = n / p[i]; q != 0; q /= p[i])
+            {
+                e[i] += q;
+            }
+        }
+        return product_of_powers(p, e);
+    }
+
+    // Return the binomial coefficient (n choose k), by prime power
+    // decomposition, with the exponent of each prime p given by the number of
+    // carries when adding k and n - k in base p.
+    inline Unsigned binomial(Unsigned::Digit n, Unsigned::Digit k)
+    {
+        if (k > n)
+        {
+            return 0;
+        }
+        k = std::min(k, n - k);
+        std::vector<Unsigned::Digit> p = primes(n);
+        std::vector<Unsigned::Digit> e(p.size(), 0);
+        for (size_t i = 0; i < p.size(); ++i)
+        {
+            Unsigned::Digit q = n, a = k, b = n - k;
+            while (q != 0)
+            {
+                q /= p[i];
+                a /= p[i];
+                b /= p[i];
+                e[i] += q - a - b;
+            }
+        }
+        return product_of_powers(p, e);
+    }
+
+    // Return the product of primes p <= n.
+    inline Unsigned primorial(Unsigned::Digit n)
+    {
+        return product(primes(n));
+    }
+} // namespace math
+
+#endif // MATH_PRODUCT_H
@@ -4,9 +4,14 @@
 #include "math_Integer.h"
 #include <cmath>
 #include <cfloat>
+#include <type_traits>
 
 namespace math
 {
+    // Numerators and denominators that fit in a machine word are kept in
+    // Integer's inline form, and operations on them use native overflow-
+    // checked arithmetic and binary GCD, falling back to the general
+    // Integer path when an intermediate result overflows.
     class Rational
     {
     public:
@@ -80,6 +85,14 @@ namespace math
             // empty
         }
 
+        // Moved-from value is zero.
+        Rational(Rational&& copy) noexcept :
+            a(std::move(copy.a)),
+            b(std::move(copy.b))
+        {
+            copy.b = 1;
+        }
+
         Rational& operator= (const Rational& rhs)
         {
             a = rhs.a;
@@ -87,18 +100,40 @@ namespace math
             return *this;
         }
 
-        Rational operator+ () const
+        Rational& operator= (Rational&& rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                a = std::move(rhs.a);
+                b = std::move(rhs.b);
+                rhs.b = 1;
+            }
+            return *this;
+        }
+
+        Rational operator+ () const &
         {
             return *this;
         }
 
-        Rational operator- () const
+        Rational operator+ () &&
+        {
+            return std::move(*this);
+        }
+
+        Rational operator- () const &
         {
             Rational w(*this);
             w.a = -w.a;
             return w;
         }
 
+        Rational operator- () &&
+        {
+            a = -std::move(a);
+            return std::move(*this);
+        }
+
         Rational operator++ (int)
         {
             Rational w(*this);
@@ -131,12 +166,15 @@ namespace math
             return u;
         }
 
+        friend Rational operator+ (const Rational& u, Rational&& v)
+        {
+            v += u;
+            return std::move(v);
+        }
+
         Rational& operator+= (const Rational& rhs)
         {
-            a *= rhs.b;
-            a += b * rhs.a;
-            b *= rhs.b;
-            reduce();
+            add(rhs, false);
             return *this;
         }
 
@@ -146,12 +184,16 @@ namespace math
             return u;
         }
 
+        friend Rational operator- (const Rational& u, Rational&& v)
+        {
+            v -= u;
+            v.a = -std::move(v.a);
+            return std::move(v);
+        }
+
         Rational& operator-= (const Rational& rhs)
         {
-            a *= rhs.b;
-            a -= b * rhs.a;
-            b *= rhs.b;
-            reduce();
+            add(rhs, true);
             return *this;
         }
 
@@ -161,11 +203,35 @@ namespace math
             return u;
         }
 
+        friend Rational operator* (const Rational& u, Rational&& v)
+        {
+            v *= u;
+            return std::move(v);
+        }
+
+        // Cancel common factors before multiplying (Henrici), so that the
+        // result is already in lowest terms.
         Rational& operator*= (const Rational& rhs)
         {
-            a *= rhs.a;
-            b *= rhs.b;
-            reduce();
+            if (is_small() && rhs.is_small())
+            {
+                const std::int64_t g1 = static_cast<std::int64_t>(
+                    gcd_small(Integer::to_uint64(a.small), rhs.b.small));
+                const std::int64_t g2 = static_cast<std::int64_t>(
+                    gcd_small(Integer::to_uint64(rhs.a.small), b.small));
+                std::int64_t n, d;
+                if (Integer::mul_small(a.small / g1, rhs.a.small / g2, n) &&
+                    Integer::mul_small(b.small / g2, rhs.b.small / g1, d))
+                {
+                    set_small(n, d);
+                    return *this;
+                }
+            }
+            const Integer g1 = gcd(a.abs(), rhs.b.abs());
+            const Integer g2 = gcd(rhs.a.abs(), b.abs());
+            Integer n = (a / g1) * (rhs.a / g2);
+            Integer d = (b / g2) * (rhs.b / g1);
+            set(std::move(n), std::move(d));
             return *this;
         }
 
@@ -177,30 +243,245 @@ namespace math
 
         Rational& operator/= (const Rational& rhs)
         {
-            a *= rhs.b;
-            b *= rhs.a;
-            reduce();
+            if (rhs.a.signum() == 0)
+            {
+                throw std::overflow_error("Error: Rational::overflow");
+            }
+            if (is_small() && rhs.is_small())
+            {
+                const std::int64_t g1 = static_cast<std::int64_t>(gcd_small(
+                    Integer::to_uint64(a.small),
+                    Integer::to_uint64(rhs.a.small)));
+                const std::int64_t g2 = static_cast<std::int64_t>(
+                    gcd_small(b.small, rhs.b.small));
+                std::int64_t n, d;
+                if (Integer::mul_small(a.small / g1, rhs.b.small / g2, n) &&
+                    Integer::mul_small(b.small / g2, rhs.a.small / g1, d))
+                {
+                    if (d < 0)
+                    {
+                        n = -n;
+                        d = -d;
+                    }
+                    set_small(n, d);
+                    return *this;
+                }
+            }
+            const Integer g1 = gcd(a.abs(), rhs.a.abs());
+            const Integer g2 = gcd(b.abs(), rhs.b.abs());
+            Integer n = (a / g1) * (rhs.b / g2);
+            Integer d = (b / g2) * (rhs.a / g1);
+            if (d.signum() < 0)
+            {
+                n = -std::move(n);
+                d = -std::move(d);
+            }
+            set(std::move(n), std::move(d));
             return *this;
         }
 
+    private:
+        // Operations with an Integer operand are templates matching only
+        // Integer, so that other arguments (e.g., int or double) still
+        // convert to Rational.
+        template<typename T, typename R = Rational>
+        using IfInteger = typename std::enable_if<
+            std::is_same<T, Integer>::value, R>::type;
+
+    public:
+        template<typename T>
+        friend IfInteger<T> operator+ (Rational u, const T& v)
+        {
+            u += v;
+            return u;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator+ (const T& u, Rational v)
+        {
+            v += u;
+            return v;
+        }
+
+        // a/b + n = (a + n*b)/b is already in lowest terms.
+        template<typename T>
+        IfInteger<T, Rational&> operator+= (const T& rhs)
+        {
+            a += rhs * b;
+            return *this;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator- (Rational u, const T& v)
+        {
+            u -= v;
+            return u;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator- (const T& u, Rational v)
+        {
+            v -= u;
+            v.a = -std::move(v.a);
+            return v;
+        }
+
+        template<typename T>
+        IfInteger<T, Rational&> operator-= (const T& rhs)
+        {
+            a -= rhs * b;
+            return *this;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator* (Rational u, const T& v)
+        {
+            u *= v;
+            return u;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator* (const T& u, Rational v)
+        {
+            v *= u;
+            return v;
+        }
+
+        // (a/b) * n = (a*(n/g)) / (b/g), with g = gcd(n, b).
+        template<typename T>
+        IfInteger<T, Rational&> operator*= (const T& rhs)
+        {
+            if (is_small() && rhs.is_small)
+            {
+                const std::int64_t g = static_cast<std::int64_t>(
+                    gcd_small(Integer::to_uint64(rhs.small), b.small));
+                std::int64_t n;
+                if (Integer::mul_small(a.small, rhs.small / g, n))
+                {
+                    set_small(n, b.small / g);
+                    return *this;
+                }
+            }
+            const Integer g = gcd(rhs.abs(), b.abs());
+            Integer n = a * (rhs / g);
+            set(std::move(n), b / g);
+            return *this;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator/ (Rational u, const T& v)
+        {
+            u /= v;
+            return u;
+        }
+
+        template<typename T>
+        friend IfInteger<T> operator/ (const T& u, Rational v)
+        {
+            if (v.a.signum() == 0)
+            {
+                throw std::overflow_error("Error: Rational::overflow");
+            }
+            std::swap(v.a, v.b);
+            if (v.b.signum() < 0)
+            {
+                v.a = -std::move(v.a);
+                v.b = -std::move(v.b);
+            }
+            v *= u;
+            return v;
+        }
+
+        // (a/b) / n = (a/g) / (b*(n/g)), with g = gcd(a, n).
+        template<typename T>
+        IfInteger<T, Rational&> operator/= (const T& rhs)
+        {
+            if (rhs.signum() == 0)
+            {
+                throw std::overflow_error("Error: Rational::overflow");
+            }
+            if (is_small() && rhs.is_small)
+            {
+                const std::int64_t g = static_cast<std::int64_t>(gcd_small(
+                    Integer::to_uint64(a.small),
+                    Integer::to_uint64(rhs.small)));
+                std::int64_t d;
+                if (Integer::mul_small(b.small, rhs.small / g, d))
+                {
+                    const std::int64_t n = a.small / g;
+                    set_small((d < 0) ? -n : n, (d < 0) ? -d : d);
+                    return *this;
+                }
+            }
+            const Integer g = gcd(a.abs(), rhs.abs());
+            Integer n = a / g;
+            Integer d = b * (rhs / g);
+            if (d.signum() < 0)
+            {
+                n = -std::move(n);
+                d = -std::move(d);
+            }
+            set(std::move(n), std::move(d));
+            return *this;
+        }
+
+        // Return -1, 0, or 1 as this is less than, equal to, or greater
+        // than rhs, deciding by signs and common denominators first.
+        int compare(const Rational& rhs) const
+        {
+            const int s = a.signum();
+            const int t = rhs.a.signum();
+            if (s != t || s == 0)
+            {
+                return (s > t) - (s < t);
+            }
+#if defined(__SIZEOF_INT128__)
+            if (is_small() && rhs.is_small())
+            {
+                __extension__ typedef __int128 Wide;
+                const Wide x = static_cast<Wide>(a.small) * rhs.b.small;
+                const Wide y = static_cast<Wide>(rhs.a.small) * b.small;
+                return (x > y) - (x < y);
+            }
+#endif
+            Unsigned t1, t2, t3, t4;
+            const Unsigned& u = a.magnitude(t1);
+            const Unsigned& v = rhs.a.magnitude(t2);
+            int c = 0;
+            if (b == rhs.b)
+            {
+                c = (v < u) - (u < v);
+            }
+            else if (u == v)
+            {
+                c = (b < rhs.b) - (rhs.b < b);
+            }
+            else
+            {
+                c = Unsigned::compare_products(u, rhs.b.magnitude(t3), v,
+                    b.magnitude(t4));
+            }
+            return s * c;
+        }
+
         friend bool operator< (const Rational& u, const Rational& v)
         {
-            return (u.a * v.b < u.b * v.a);
+            return (u.compare(v) < 0);
         }
 
         friend bool operator> (const Rational& u, const Rational& v)
         {
-            return (u.a * v.b > u.b * v.a);
+            return (u.compare(v) > 0);
         }
 
         friend bool operator<= (const Rational& u, const Rational& v)
         {
-            return (u.a * v.b <= u.b * v.a);
+            return (u.compare(v) <= 0);
         }
 
         friend bool operator>= (const Rational& u, const Rational& v)
         {
-            return (u.a * v.b >= u.b * v.a);
+            return (u.compare(v) >= 0);
         }
 
         friend bool operator== (const Rational& u, const Rational& v)
@@ -213,6 +494,78 @@ namespace math
             return (u.a != v.a || u.b != v.b);
         }
 
+        template<typename T>
+        friend IfInteger<T, bool> operator< (const Rational& u, const T& v)
+        {
+            return (u.compare_integer(v) < 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator< (const T& u, const Rational& v)
+        {
+            return (v.compare_integer(u) > 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator> (const Rational& u, const T& v)
+        {
+            return (u.compare_integer(v) > 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator> (const T& u, const Rational& v)
+        {
+            return (v.compare_integer(u) < 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator<= (const Rational& u, const T& v)
+        {
+            return (u.compare_integer(v) <= 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator<= (const T& u, const Rational& v)
+        {
+            return (v.compare_integer(u) >= 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator>= (const Rational& u, const T& v)
+        {
+            return (u.compare_integer(v) >= 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator>= (const T& u, const Rational& v)
+        {
+            return (v.compare_integer(u) <= 0);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator== (const Rational& u, const T& v)
+        {
+            return (u.b == 1 && u.a == v);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator== (const T& u, const Rational& v)
+        {
+            return (v.b == 1 && v.a == u);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator!= (const Rational& u, const T& v)
+        {
+            return !(u == v);
+        }
+
+        template<typename T>
+        friend IfInteger<T, bool> operator!= (const T& u, const Rational& v)
+        {
+            return !(v == u);
+        }
+
         Integer numerator() const
         {
             return a;
@@ -225,6 +578,17 @@ namespace math
 
         double to_double() const
         {
+            // Numerator and denominator exactly representable, so that a
+            // single (correctly rounded) division suffices.
+            const std::int64_t mant = static_cast<std::int64_t>(1) <<
+                DBL_MANT_DIG;
+            if (is_small() && -mant <= a.small && a.small <= mant &&
+                b.small <= mant)
+            {
+                return static_cast<double>(a.small) /
+                    static_cast<double>(b.small);
+            }
+
             // Compute a/b = n/d * 2^exponent, with 1/4 < n/d < 1.
             Unsigned n = a.abs();
             Unsigned d = b.abs();
@@ -258,14 +622,20 @@ namespace math
             exponent -= bits;
             n.divide(d, n, r);
             r <<= 1;
-            if (r > d || (r == d && (n & 1) != 0))
+            if (r > d || (r == d && n.test_bit(0)))
             {
                 ++n;
             }
 
-            // Convert to double (assume BITS <= DBL_MANT_DIG <= 2*BITS).
-            double x = std::ldexp(std::ldexp((n >> Unsigned::BITS).to_uint(),
-                Unsigned::BITS) + n.to_uint(), exponent);
+            // Convert to double, one digit at a time (exact, since n has at
+            // most DBL_MANT_DIG + 1 bits).
+            double x = 0;
+            for (int shift = 0; n != 0; shift += Unsigned::BITS)
+            {
+                x += std::ldexp(static_cast<double>(n.to_uint()), shift);
+                n >>= Unsigned::BITS;
+            }
+            x = std::ldexp(x, exponent);
             return ((a.signum() < 0) ? -x : x);
         }
 
@@ -288,7 +658,7 @@ namespace math
             Unsigned r;
             n.divide(b.abs(), n, r);
             r <<= 1;
-            if (r > b.abs() || (r == b.abs() && (n & 1) != 0))
+            if (r > b.abs() || (r == b.abs() && n.test_bit(0)))
             {
                 ++n;
             }
@@ -366,12 +736,26 @@ namespace math
                         case '.':
                         {
                             is.ignore(1);
-                            char digit = '\0';
+                            std::string s;
                             while (std::isdigit(is.peek()))
                             {
-                                is >> digit;
-                                u.a = 10 * u.a + (digit - '0');
-                                u.b *= 10;
+                                s.push_back(static_cast<char>(is.get()));
+                            }
+                            if (!s.empty())
+                            {
+                                // Compute d = 10 ^ s.size().
+                                Unsigned n = 10;
+                                Unsigned d = 1;
+                                for (size_t j = s.size(); j != 0; j >>= 1)
+                                {
+                                    if ((j & 1) != 0)
+                                    {
+                                        d *= n;
+                                    }
+                                    n *= n;
+                                }
+                                u.a = u.a * d + Unsigned(s);
+                                u.b = d;
                             }
                             break;
                         }
@@ -403,6 +787,26 @@ namespace math
 
         void reduce()
         {
+            if (is_small())
+            {
+                if (b.small == 0)
+                {
+                    throw std::overflow_error("Error: Rational::overflow");
+                }
+                if (b.small < 0)
+                {
+                    a.small = -a.small;
+                    b.small = -b.small;
+                }
+                const std::int64_t d = static_cast<std::int64_t>(
+                    gcd_small(Integer::to_uint64(a.small), b.small));
+                if (d != 1)
+                {
+                    a.small /= d;
+                    b.small /= d;
+                }
+                return;
+            }
             switch (b.signum())
             {
             case 0:
@@ -415,16 +819,141 @@ namespace math
             default:
                 break;
             }
-            Unsigned d(a.abs());
-            Unsigned c(b.abs());
-            while (c != 0)
+            const Unsigned d = gcd(a.abs(), b.abs());
+            if (d != 1)
+            {
+                a /= d;
+                b /= d;
+            }
+        }
+
+        // Add (or subtract) rhs by Henrici's method: with g = gcd(b, d),
+        // a/b + c/d = (a*(d/g) + c*(b/g)) / (b*(d/g)), where only factors
+        // of g can be common to numerator and denominator.
+        void add(const Rational& rhs, bool is_subtract)
+        {
+            if (is_small() && rhs.is_small() && add_small(rhs, is_subtract))
+            {
+                return;
+            }
+            const Integer g = gcd(b.abs(), rhs.b.abs());
+            if (g == 1)
+            {
+                Integer t = is_subtract ? a * rhs.b - b * rhs.a :
+                    a * rhs.b + b * rhs.a;
+                b *= rhs.b;
+                a = std::move(t);
+                return;
+            }
+            const Integer bg = b / g;
+            Integer t = is_subtract ? a * (rhs.b / g) - rhs.a * bg :
+                a * (rhs.b / g) + rhs.a * bg;
+            const Integer g2 = gcd(t.abs(), g.abs());
+            Integer d = bg * (rhs.b / g2);
+            set(t / g2, std::move(d));
+        }
+
+        // Set this = n/d, already in lowest terms with d > 0.
+        void set(Integer&& n, Integer&& d)
+        {
+            a = std::move(n);
+            b = (a.signum() == 0) ? Integer(1) : std::move(d);
+        }
+
+        // Return -1, 0, or 1 as this is less than, equal to, or greater
+        // than n, comparing a with n*b by bounds before multiplying.
+        int compare_integer(const Integer& n) const
+        {
+            const int s = a.signum();
+            const int t = n.signum();
+            if (s != t || s == 0)
+            {
+                return (s > t) - (s < t);
+            }
+            if (b == 1)
             {
-                Unsigned r = d % c;
-                d = c;
-                c = r;
+                return (n < a) - (a < n);
             }
-            a /= d;
-            b /= d;
+#if defined(__SIZEOF_INT128__)
+            if (is_small() && n.is_small)
+            {
+                __extension__ typedef __int128 Wide;
+                const Wide y = static_cast<Wide>(n.small) * b.small;
+                return (a.small > y) - (a.small < y);
+            }
+#endif
+            Unsigned t1, t2, t3;
+            return s * Unsigned::compare_products(a.magnitude(t1), 1,
+                n.magnitude(t2), b.magnitude(t3));
+        }
+
+        bool is_small() const
+        {
+            return (a.is_small && b.is_small);
+        }
+
+        // Set this = n/d, already in lowest terms with d > 0, both inline.
+        void set_small(std::int64_t n, std::int64_t d)
+        {
+            a.small = n;
+            b.small = (n == 0) ? 1 : d;
+        }
+
+        // Add (or subtract) rhs as in add(), with inline numerators and
+        // denominators; return false if an intermediate result overflows.
+        bool add_small(const Rational& rhs, bool is_subtract)
+        {
+            const std::int64_t g = static_cast<std::int64_t>(
+                gcd_small(b.small, rhs.b.small));
+            const std::int64_t bg = b.small / g;
+            std::int64_t u, v, t, d;
+            if (!Integer::mul_small(a.small, rhs.b.small / g, u) ||
+                !Integer::mul_small(rhs.a.small, bg, v) ||
+                !Integer::add_small(u, is_subtract ? -v : v, t))
+            {
+                return false;
+            }
+            const std::int64_t g2 = static_cast<std::int64_t>(
+                gcd_small(Integer::to_uint64(t), g));
+            if (!Integer::mul_small(bg, rhs.b.small / g2, d))
+            {
+                return false;
+            }
+            set_small(t / g2, d);
+            return true;
+        }
+
+        // Return greatest common divisor of u and v, by binary GCD.
+        static std::uint64_t gcd_small(std::uint64_t u, std::uint64_t v)
+        {
+            if (u == 0 || v == 0)
+            {
+                return (u | v);
+            }
+            const int shift = trailing_zeros(u | v);
+            u >>= trailing_zeros(u);
+            while (v != 0)
+            {
+                v >>= trailing_zeros(v);
+                if (u > v)
+                {
+                    std::swap(u, v);
+                }
+                v -= u;
+            }
+            return (u << shift);
+        }
+
+        // Return number of trailing zero bits in u != 0.
+        static int trailing_zeros(std::uint64_t u)
+        {
+#if defined(__GNUC__)
+            return __builtin_ctzll(u);
+#else
+            int n = 0;
+            for (; (u & 1) == 0; u >>= 1, ++n);
+            return n;
+#endif
         }
     };
 } // namespace math
@@ -0,0 +1,283 @@
+#ifndef MATH_RNS_H
+#define MATH_RNS_H
+
+#include "math_Integer.h"
+#include "math_Product.h"
+#include <memory>
+
+namespace math
+{
+    // Residue number system: an integer x is represented by its residues
+    // x mod p[i] for a basis of distinct primes p[i] < 2^31, with product M.
+    // Addition, subtraction, and multiplication act independently on each
+    // residue, and are exact for results with magnitude less than M/2.
+    class Rns
+    {
+    public:
+        typedef std::uint32_t Residue;
+
+        // Primes and precomputed constants for conversion, shared by values.
+        class Basis
+        {
+        public:
+            // Choose the largest primes below 2^31, enough that M > 2^bits.
+            explicit Basis(size_t bits) :
+                p(),
+                weights(),
+                tree(),
+                half()
+            {
+                std::vector<Unsigned> m;
+                size_t total = 0;
+                for (Residue q = 0x7fffffff; total <= bits; q -= 2)
+                {
+                    if (is_prime(q))
+                    {
+                        p.push_back(q);
+                        m.push_back(q);
+                        total += 30;
+                    }
+                }
+                tree = product_tree(m);
+                half = modulus() >> 1;
+
+                // weights[i] = (M/p[i])^-1 mod p[i], with M/p[i] mod p[i]
+                // computed as (M mod p[i]^2)/p[i].
+                for (size_t i = 0; i < m.size(); ++i)
+                {
+                    m[i] = m[i] * m[i];
+                }
+                const std::vector<Unsigned> r = remainders(modulus(), m);
+                weights.resize(p.size());
+                for (size_t i = 0; i < p.size(); ++i)
+                {
+                    const Residue c =
+                        static_cast<Residue>((r[i] / p[i]).to_uint());
+                    weights[i] = pow_mod(c, p[i] - 2, p[i]);
+                }
+            }
+
+            size_t size() const
+            {
+                return p.size();
+            }
+
+            const Unsigned& modulus() const
+            {
+                return tree.back()[0];
+            }
+
+            const std::vector<Residue>& primes() const
+            {
+                return p;
+            }
+
+        private:
+            friend class Rns;
+
+            std::vector<Residue> p;
+            std::vector<Residue> weights;
+            std::vector<std::vector<Unsigned> > tree;
+            Unsigned half;
+
+            static Residue mul_mod(Residue a, Residue b, Residue m)
+            {
+                return static_cast<Residue>(
+                    static_cast<std::uint64_t>(a) * b % m);
+            }
+
+            static Residue pow_mod(Residue a, Residue e, Residue m)
+            {
+                Residue w = 1;
+                for (; e != 0; e >>= 1)
+                {
+                    if (e & 1)
+                    {
+                        w = mul_mod(w, a, m);
+                    }
+                    a = mul_mod(a, a, m);
+                }
+                return w;
+            }
+
+            // Miller-Rabin with bases 2, 7, 61, deterministic below 2^32.
+            static bool is_prime(Residue n)
+            {
+                static const Residue bases[] = {2, 7, 61};
+                Residue d = n - 1;
+                int s = 0;
+                for (; d % 2 == 0; d /= 2, ++s);
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    if (bases[i] % n == 0)
+                    {
+                        continue;
+                    }
+                    Residue x = pow_mod(bases[i], d, n);
+                    bool is_witness = (x != 1 && x != n - 1);
+                    for (int j = 1; j < s && is_witness; ++j)
+                    {
+                        x = mul_mod(x, x, n);
+                        is_witness = (x != n - 1);
+                    }
+                    if (is_witness)
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        };
+
+        Rns(const std::shared_ptr<const Basis>& rns_basis,
+            const Integer& u = 0) :
+            basis(rns_basis),
+            r()
+        {
+            r.reserve(basis->size());
+            const std::vector<Unsigned> w = remainders(u.abs(), basis->tree);
+            for (size_t i = 0; i < w.size(); ++i)
+            {
+                const Residue x = static_cast<Residue>(w[i].to_uint());
+                r.push_back((u < 0 && x != 0) ? basis->p[i] - x : x);
+            }
+        }
+
+        const std::shared_ptr<const Basis>& get_basis() const
+        {
+            return basis;
+        }
+
+        const std::vector<Residue>& residues() const
+        {
+            return r;
+        }
+
+        friend Rns operator+ (Rns u, const Rns& v)
+        {
+            u += v;
+            return u;
+        }
+
+        Rns& operator+= (const Rns& rhs)
+        {
+            check(rhs);
+            const Residue* p = basis->p.data();
+            for (size_t i = 0; i < r.size(); ++i)
+            {
+                const Residue x = r[i] + rhs.r[i];
+                r[i] = (x >= p[i]) ? x - p[i] : x;
+            }
+            return *this;
+        }
+
+        Rns operator- () const
+        {
+            Rns w(*this);
+            const Residue* p = basis->p.data();
+            for (size_t i = 0; i < r.size(); ++i)
+            {
+                w.r[i] = (r[i] == 0) ? 0 : p[i] - r[i];
+            }
+            return w;
+        }
+
+        friend Rns operator- (Rns u, const Rns& v)
+        {
+            u -= v;
+            return u;
+        }
+
+        Rns& operator-= (const Rns& rhs)
+        {
+            check(rhs);
+            const Residue* p = basis->p.data();
+            for (size_t i = 0; i < r.size(); ++i)
+            {
+                const Residue x = r[i] - rhs.r[i];
+                r[i] = (r[i] < rhs.r[i]) ? x + p[i] : x;
+            }
+            return *this;
+        }
+
+        friend Rns operator* (Rns u, const Rns& v)
+        {
+            u *= v;
+            return u;
+        }
+
+        Rns& operator*= (const Rns& rhs)
+        {
+            check(rhs);
+            const Residue* p = basis->p.data();
+            for (size_t i = 0; i < r.size(); ++i)
+            {
+                r[i] = Basis::mul_mod(r[i], rhs.r[i], p[i]);
+            }
+            return *this;
+        }
+
+        friend bool operator== (const Rns& u, const Rns& v)
+        {
+            return u.basis == v.basis && u.r == v.r;
+        }
+
+        friend bool operator!= (const Rns& u, const Rns& v)
+        {
+            return !(u == v);
+        }
+
+        // Return the represented value in [0, M), by Chinese remaindering:
+        // sum of c[i] M/p[i], with c[i] = r[i] weights[i] mod p[i], summed
+        // up the product tree as s = s_left P_right + s_right P_left.
+        Unsigned to_unsigned() const
+        {
+            const std::vector<std::vector<Unsigned> >& tree = basis->tree;
+            std::vector<Unsigned> s(r.size());
+            for (size_t i = 0; i < r.size(); ++i)
+            {
+                s[i] = Basis::mul_mod(r[i], basis->weights[i], basis->p[i]);
+            }
+            for (size_t k = 0; k + 1 < tree.size(); ++k)
+            {
+                const std::vector<Unsigned>& w = tree[k];
+                std::vector<Unsigned> next((s.size() + 1) / 2);
+                for (size_t i = 0; i + 1 < s.size(); i += 2)
+                {
+                    next[i / 2] = s[i] * w[i + 1] + s[i + 1] * w[i];
+                }
+                if (s.size() % 2 != 0)
+                {
+                    next.back() = std::move(s.back());
+                }
+                s.swap(next);
+            }
+            return s[0] % basis->modulus();
+        }
+
+        // Return the represented value with magnitude less than M/2.
+        Integer to_integer() const
+        {
+            Unsigned x = to_unsigned();
+            if (x <= basis->half)
+            {
+                return x;
+            }
+            return -Integer(basis->modulus() - x);
+        }
+
+    private:
+        std::shared_ptr<const Basis> basis;
+        std::vector<Residue> r;
+
+        void check(const Rns& rhs) const
+        {
+            if (basis != rhs.basis)
+            {
+                throw std::runtime_error("Error: Rns::basis");
+            }
+        }
+    };
+} // namespace math
+
+#endif // MATH_RNS_H
@@ -0,0 +1,110 @@
+#ifndef MATH_SERIES_H
+#define MATH_SERIES_H
+
+#include "math_Rational.h"
+
+namespace math
+{
+    // Binary splitting evaluation of the series
+    //
+    //     S(n1, n2) = sum_{k=n1}^{n2-1} p(k) r(n1)...r(k-1) / (q(n1)...q(k)),
+    //
+    // where term.p(k), term.q(k), and term.r(k) return Integer or (small)
+    // built-in integers, converted via Integer(std::int64_t); unsigned values
+    // above INT64_MAX would wrap to negative values.  For example, with p(k) =
+    // r(k) = 1, q(0) = 1, and q(k) = k, S(0, n) is the sum of 1/k! for k < n.
+    // The sum is computed as P/Q, where P, Q, and R are accumulated over a
+    // balanced recursion tree, so that large products are of similar size.
+    template<typename Term>
+    class Series
+    {
+    public:
+        Series(const Term& t, size_t n1, size_t n2) :
+            term(t),
+            p(0),
+            q(1),
+            r(1)
+        {
+            if (n1 < n2)
+            {
+                split(n1, n2, false, p, q, r);
+            }
+        }
+
+        // Return the exact sum, in lowest terms.
+        Rational value() const
+        {
+            return Rational(p, q);
+        }
+
+        // Return the sum scaled by the given factor, truncated toward zero.
+        Integer scaled(const Integer& scale) const
+        {
+            return p * scale / q;
+        }
+
+        // Return the unreduced numerator and denominator of the sum.
+        const Integer& numerator() const
+        {
+            return p;
+        }
+
+        const Integer& denominator() const
+        {
+            return q;
+        }
+
+    private:
+        Term term;
+        Integer p;
+        Integer q;
+        Integer r;
+
+        // Compute P, Q, and (if needed) R for the terms in [n1, n2).
+        void split(size_t n1, size_t n2, bool need_r,
+            Integer& p1, Integer& q1, Integer& r1) const
+        {
+            if (n2 - n1 == 1)
+            {
+                p1 = term.p(n1);
+                q1 = term.q(n1);
+                if (need_r)
+                {
+                    r1 = term.r(n1);
+                }
+                return;
+            }
+            const size_t m = n1 + (n2 - n1) / 2;
+            Integer p2, q2, r2;
+            split(n1, m, true, p1, q1, r1);
+            split(m, n2, need_r, p2, q2, r2);
+
+            // S(n1, n2) = S(n1, m) + R(n1, m)/Q(n1, m) S(m, n2).
+            p1 *= q2;
+            p1 += r1 * p2;
+            q1 *= q2;
+            if (need_r)
+            {
+                r1 *= r2;
+            }
+        }
+    };
+
+    // Return the exact sum of the series in [n1, n2).
+    template<typename Term>
+    Rational series(const Term& term, size_t n1, size_t n2)
+    {
+        return Series<Term>(term, n1, n2).value();
+    }
+
+    // Return the sum of the series in [n1, n2) times scale, truncated toward
+    // zero; e.g., scale = 10^digits yields a fixed-point decimal value.
+    template<typename Term>
+    Integer series(const Term& term, size_t n1, size_t n2,
+        const Integer& scale)
+    {
+        return Series<Term>(term, n1, n2).scaled(scale);
+    }
+} // namespace math
+
+#endif // MATH_SERIES_H
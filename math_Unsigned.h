@@ -8,16 +8,36 @@
 #include <algorithm>
 #include <sstream>
 #include <cctype>
+#include <utility>
 using std::size_t;
 
+// Define MATH_DIGIT64 to use 64-bit digits, with 128-bit intermediates.
+#if defined(MATH_DIGIT64) && !defined(__SIZEOF_INT128__)
+#error "MATH_DIGIT64 requires unsigned __int128"
+#endif
+
+// With 64-bit digits on x86-64, select ADX/BMI2 kernels at run time.
+#if defined(MATH_DIGIT64) && defined(__x86_64__) && defined(__GNUC__)
+#define MATH_KERNELS_ADX
+#include <cstddef>
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 namespace math
 {
     class Unsigned
     {
     public:
+#ifdef MATH_DIGIT64
+        typedef std::uint64_t Digit;
+        __extension__ typedef unsigned __int128 Wigit;
+        static const unsigned BITS = 64;
+#else
         typedef std::uint32_t Digit;
         typedef std::uint64_t Wigit;
         static const unsigned BITS = 32;
+#endif
 
         Unsigned(Digit u = 0) :
             digits(1, u)
@@ -42,12 +62,25 @@ namespace math
             // empty
         }
 
+        // Moved-from value is zero.
+        Unsigned(Unsigned&& copy) noexcept :
+            digits(std::move(copy.digits))
+        {
+            // empty
+        }
+
         Unsigned& operator= (const Unsigned& rhs)
         {
             digits = rhs.digits;
             return *this;
         }
 
+        Unsigned& operator= (Unsigned&& rhs) noexcept
+        {
+            digits = std::move(rhs.digits);
+            return *this;
+        }
+
         Unsigned operator++ (int)
         {
             Unsigned w(*this);
@@ -89,6 +122,12 @@ namespace math
             return u;
         }
 
+        friend Unsigned operator+ (const Unsigned& u, Unsigned&& v)
+        {
+            v += u;
+            return std::move(v);
+        }
+
         Unsigned& operator+= (const Unsigned& rhs)
         {
             const size_t n = rhs.digits.size();
@@ -96,14 +135,9 @@ namespace math
             {
                 digits.resize(n, 0);
             }
-            size_t j = 0;
-            Wigit k = 0;
-            for (; j < n; ++j)
-            {
-                k = k + digits[j] + rhs.digits[j];
-                digits[j] = static_cast<Digit>(k);
-                k >>= BITS;
-            }
+            size_t j = n;
+            Wigit k = add_n(digits.data(), digits.data(), rhs.digits.data(),
+                n);
             for (; k != 0 && j < digits.size(); ++j)
             {
                 k += digits[j];
@@ -117,26 +151,62 @@ namespace math
             return *this;
         }
 
+        friend Unsigned operator+ (Unsigned u, Digit v)
+        {
+            u += v;
+            return u;
+        }
+
+        friend Unsigned operator+ (Digit u, Unsigned v)
+        {
+            v += u;
+            return v;
+        }
+
+        Unsigned& operator+= (Digit rhs)
+        {
+            digits[0] += rhs;
+            if (digits[0] < rhs)
+            {
+                size_t j = 1;
+                for (; j < digits.size() && ++digits[j] == 0; ++j);
+                if (j == digits.size())
+                {
+                    digits.push_back(1);
+                }
+            }
+            return *this;
+        }
+
         friend Unsigned operator- (Unsigned u, const Unsigned& v)
         {
             u -= v;
             return u;
         }
 
-        Unsigned& operator-= (const Unsigned& rhs)
+        friend Unsigned operator- (const Unsigned& u, Unsigned&& v)
         {
-            if ((*this) < rhs)
+            if (u < v)
             {
                 throw std::underflow_error("Error: Unsigned::underflow");
             }
-            size_t j = 0;
-            Wigit k = 0;
-            for (; j < rhs.digits.size(); ++j)
+            const size_t n = v.digits.size();
+            v.digits.resize(u.digits.size());
+            sub(v.digits.data(), u.digits.data(), u.digits.size(),
+                v.digits.data(), n);
+            v.trim();
+            return std::move(v);
+        }
+
+        Unsigned& operator-= (const Unsigned& rhs)
+        {
+            if ((*this) < rhs)
             {
-                k = k + digits[j] - rhs.digits[j];
-                digits[j] = static_cast<Digit>(k);
-                k = ((k >> BITS) ? -1 : 0);
+                throw std::underflow_error("Error: Unsigned::underflow");
             }
+            size_t j = rhs.digits.size();
+            Wigit k = 0 - static_cast<Wigit>(sub_n(digits.data(),
+                digits.data(), rhs.digits.data(), j));
             for (; k != 0 && j < digits.size(); ++j)
             {
                 k += digits[j];
@@ -147,23 +217,152 @@ namespace math
             return *this;
         }
 
+        friend Unsigned operator- (Unsigned u, Digit v)
+        {
+            u -= v;
+            return u;
+        }
+
+        Unsigned& operator-= (Digit rhs)
+        {
+            if (digits[0] < rhs)
+            {
+                if (digits.size() == 1)
+                {
+                    throw std::underflow_error("Error: Unsigned::underflow");
+                }
+                for (size_t j = 1; digits[j]-- == 0; ++j);
+            }
+            digits[0] -= rhs;
+            trim();
+            return *this;
+        }
+
         friend Unsigned operator* (const Unsigned& u, const Unsigned& v)
         {
+            if (&u == &v)
+            {
+                return u.square();
+            }
             const size_t m = u.digits.size();
             const size_t n = v.digits.size();
+            if (m < n)
+            {
+                return v * u;
+            }
+            if (n >= NTT_THRESHOLD && m + n <= NTT_MAX_DIGITS)
+            {
+                return multiply_ntt(u, v);
+            }
+            if (n >= TOOM3_THRESHOLD)
+            {
+                return (m < 2 * n) ? mul_toom3(u, v) : mul_unbalanced(u, v);
+            }
             Unsigned w;
-            w.digits.resize(m + n, 0);
-            for (size_t j = 0; j < n; ++j)
+            w.digits.resize(m + n);
+            std::vector<Digit> scratch(mul_scratch(m));
+            mul(w.digits.data(), u.digits.data(), m, v.digits.data(), n,
+                scratch.data());
+            w.trim();
+            return w;
+        }
+
+        // Return this * this.
+        Unsigned square() const
+        {
+            const size_t n = digits.size();
+            if (n >= NTT_THRESHOLD && 2 * n <= NTT_MAX_DIGITS)
             {
-                Wigit k = 0;
-                for (size_t i = 0; i < m; ++i)
+                return multiply_ntt(*this, *this);
+            }
+            if (n >= TOOM3_THRESHOLD)
+            {
+                return mul_toom3(*this, *this);
+            }
+            Unsigned w;
+            w.digits.resize(2 * n);
+            std::vector<Digit> scratch(mul_scratch(n));
+            sqr(w.digits.data(), digits.data(), n, scratch.data());
+            w.trim();
+            return w;
+        }
+
+        // Return u * v computed by three-prime number-theoretic transform,
+        // for any operand sizes with a product of at most NTT_MAX_DIGITS.
+        static Unsigned multiply_ntt(const Unsigned& u, const Unsigned& v)
+        {
+            const size_t m = u.digits.size();
+            const size_t n = v.digits.size();
+            if (m + n > NTT_MAX_DIGITS)
+            {
+                throw std::length_error("Error: Unsigned::ntt");
+            }
+
+            // Convolve 32-bit pieces of u and v modulo each prime.
+            const unsigned PIECES = BITS / 32;
+            size_t size = 1;
+            while (size < (m + n) * PIECES)
+            {
+                size <<= 1;
+            }
+            static const Ntt ntt[3] = {
+                Ntt(2013265921, 31), Ntt(469762049, 3), Ntt(754974721, 11) };
+            std::vector<std::uint32_t> c[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                std::vector<std::uint32_t> a(size, 0), b;
+                for (size_t j = 0; j < m * PIECES; ++j)
                 {
-                    k += static_cast<Wigit>(u.digits[i]) * v.digits[j] +
-                        w.digits[i + j];
-                    w.digits[i + j] = static_cast<Digit>(k);
-                    k >>= BITS;
+                    a[j] = static_cast<std::uint32_t>(
+                        u.digits[j / PIECES] >> (j % PIECES * 32));
+                }
+                if (&u == &v)
+                {
+                    ntt[k].convolve(a, a);
+                    c[k].swap(a);
+                    continue;
+                }
+                b.resize(size, 0);
+                for (size_t j = 0; j < n * PIECES; ++j)
+                {
+                    b[j] = static_cast<std::uint32_t>(
+                        v.digits[j / PIECES] >> (j % PIECES * 32));
                 }
-                w.digits[j + m] = static_cast<Digit>(k);
+                ntt[k].convolve(a, b);
+                c[k].swap(a);
+            }
+
+            // Reconstruct each coefficient x < p0*p1*p2 by Garner's
+            // algorithm, and propagate carries (hi, lo).
+            const std::uint64_t p0 = 2013265921;
+            const std::uint64_t p1 = 469762049;
+            const std::uint64_t p2 = 754974721;
+            const std::uint64_t p01 = p0 * p1;
+            const std::uint64_t i01 = ntt[1].pow(p0 % p1, p1 - 2);
+            const std::uint64_t i012 = ntt[2].pow(p01 % p2, p2 - 2);
+            Unsigned w;
+            w.digits.assign(m + n, 0);
+            std::uint64_t lo = 0;
+            std::uint64_t hi = 0;
+            for (size_t j = 0; j < (m + n) * PIECES; ++j)
+            {
+                const std::uint64_t r0 = c[0][j];
+                const std::uint64_t t1 =
+                    (c[1][j] + p1 - r0 % p1) % p1 * i01 % p1;
+                const std::uint64_t x01 = r0 + p0 * t1;
+                const std::uint64_t t2 =
+                    (c[2][j] + p2 - x01 % p2) % p2 * i012 % p2;
+                lo += x01;
+                hi += (lo < x01);
+                const std::uint64_t t_lo = (p01 & 0xffffffff) * t2;
+                const std::uint64_t t_hi = (p01 >> 32) * t2;
+                const std::uint64_t x_lo = t_lo + (t_hi << 32);
+                lo += x_lo;
+                hi += (t_hi >> 32) + (x_lo < t_lo) + (lo < x_lo);
+                w.digits[j / PIECES] |=
+                    static_cast<Digit>(lo & 0xffffffff) << (j % PIECES * 32);
+                lo = (lo >> 32) | (hi << 32);
+                hi >>= 32;
             }
             w.trim();
             return w;
@@ -175,6 +374,30 @@ namespace math
             return *this;
         }
 
+        friend Unsigned operator* (Unsigned u, Digit v)
+        {
+            u *= v;
+            return u;
+        }
+
+        friend Unsigned operator* (Digit u, Unsigned v)
+        {
+            v *= u;
+            return v;
+        }
+
+        Unsigned& operator*= (Digit rhs)
+        {
+            const Digit k = mul_1(digits.data(), digits.data(), digits.size(),
+                rhs);
+            if (k != 0)
+            {
+                digits.push_back(k);
+            }
+            trim();
+            return *this;
+        }
+
         friend Unsigned operator/ (const Unsigned& u, const Unsigned& v)
         {
             Unsigned q, r;
@@ -189,6 +412,19 @@ namespace math
             return *this;
         }
 
+        friend Unsigned operator/ (Unsigned u, Digit v)
+        {
+            u /= v;
+            return u;
+        }
+
+        Unsigned& operator/= (Digit rhs)
+        {
+            Digit r;
+            divide(rhs, *this, r);
+            return *this;
+        }
+
         friend Unsigned operator% (const Unsigned& u, const Unsigned& v)
         {
             Unsigned q, r;
@@ -203,18 +439,52 @@ namespace math
             return *this;
         }
 
+        friend Unsigned operator% (const Unsigned& u, Digit v)
+        {
+            return Unsigned(u.mod_word(v));
+        }
+
+        Unsigned& operator%= (Digit rhs)
+        {
+            digits.assign(1, mod_word(rhs));
+            return *this;
+        }
+
+        // Return this % v as a single digit.
+        Digit mod_word(Digit v) const
+        {
+            if (v == 0)
+            {
+                throw std::overflow_error("Error: Unsigned::overflow");
+            }
+            return mod_1(digits.data(), digits.size(), v);
+        }
+
+        // Compute q = this / v and r = this % v, with a single-digit v.
+        void divide(Digit v, Unsigned& q, Digit& r) const
+        {
+            if (v == 0)
+            {
+                throw std::overflow_error("Error: Unsigned::overflow");
+            }
+            if (&q != this)
+            {
+                q.digits.resize(digits.size());
+            }
+            r = div_1(q.digits.data(), digits.data(), digits.size(), v);
+            q.trim();
+        }
+
         void divide(Unsigned v, Unsigned& q, Unsigned& r) const
         {
-            // Handle special cases (m < n).
             if (v.digits.back() == 0)
             {
                 throw std::overflow_error("Error: Unsigned::overflow");
             }
-            r.digits = digits;
             const size_t n = v.digits.size();
-            if (digits.size() < n)
+            if (n < BZ_THRESHOLD || digits.size() < n + BZ_THRESHOLD)
             {
-                q.digits.assign(1, 0);
+                divide_knuth(v, q, r);
                 return;
             }
 
@@ -222,70 +492,95 @@ namespace math
             unsigned d = BITS;
             for (Digit vn = v.digits.back(); vn != 0; vn >>= 1, --d);
             v <<= d;
-            r <<= d;
-            const Digit vn = v.digits.back();
+            const Unsigned u = (*this) << d;
 
-            // Ensure first single-digit quotient (u[m-1] < v[n-1]).
-            r.digits.push_back(0);
-            const size_t m = r.digits.size();
-            q.digits.resize(m - n);
-            Unsigned w;
-            w.digits.resize(n + 1);
-            const Wigit MAX_DIGIT = (static_cast<Wigit>(1) << BITS) - 1;
-            for (size_t j = m - n; j-- != 0;)
+            // Divide n digits of quotient at a time, using a reciprocal of v
+            // if it is reused for enough blocks of quotient.
+            const bool is_newton = (n >= NEWTON_THRESHOLD &&
+                digits.size() >= 4 * n);
+            const Unsigned x = is_newton ? reciprocal(v) : 0;
+            q.digits.assign(1, 0);
+            r.digits.assign(1, 0);
+            Unsigned w, qj;
+            for (size_t j = (u.digits.size() + n - 1) / n * n; j != 0;)
             {
-                // Estimate quotient digit.
-                Wigit qhat = std::min(MAX_DIGIT,
-                    (static_cast<Wigit>(r.digits[j + n]) << BITS |
-                        r.digits[j + n - 1]) / vn);
-
-                // Compute partial product (w = qhat * v).
-                Wigit k = 0;
-                for (size_t i = 0; i < n; ++i)
+                j -= n;
+                w = u.slice(j, n);
+                w.add_shifted(r, n);
+                if (is_newton)
                 {
-                    k += qhat * v.digits[i];
-                    w.digits[i] = static_cast<Digit>(k);
-                    k >>= BITS;
+                    // Estimate quotient digits (never too large).
+                    qj = ((w >> ((n - 1) * BITS)) * x) >> ((n + 1) * BITS);
+                    r = w - qj * v;
+                    while (r >= v)
+                    {
+                        r -= v;
+                        ++qj;
+                    }
+                }
+                else
+                {
+                    divide_recursive(w, v, qj, r);
                 }
-                w.digits[n] = static_cast<Digit>(k);
+                q.add_shifted(qj, j);
+            }
 
-                // Check if qhat is too large (u - w < 0).
-                bool is_trial = true;
-                while (is_trial)
+            // Denormalize remainder.
+            r >>= d;
+        }
+
+        // Return greatest common divisor of u and v, by half-GCD for large
+        // operands, Lehmer's algorithm, and binary GCD on double digits.
+        friend Unsigned gcd(Unsigned u, Unsigned v)
+        {
+            if (u < v)
+            {
+                std::swap(u, v);
+            }
+            bool is_odd = false;
+            while (u.digits.size() > 2 && v != 0)
+            {
+                if (v.digits.size() >= HGCD_THRESHOLD)
                 {
-                    size_t i = n;
-                    for (; i != 0 && r.digits[j + i] == w.digits[i]; --i);
-                    is_trial = (r.digits[j + i] < w.digits[i]);
-                    if (is_trial)
+                    const int n = u.bits();
+                    hgcd(u, v, 0, is_odd);
+                    if (u.bits() < n)
                     {
-                        // Adjust partial product (w -= v).
-                        --qhat;
-                        k = 0;
-                        for (size_t i2 = 0; i2 < n; ++i2)
-                        {
-                            k = k + w.digits[i2] - v.digits[i2];
-                            w.digits[i2] = static_cast<Digit>(k);
-                            k = ((k >> BITS) ? -1 : 0);
-                        }
-                        w.digits[n] = static_cast<Digit>(k + w.digits[n]);
+                        continue;
                     }
                 }
-                q.digits[j] = static_cast<Digit>(qhat);
-
-                // Compute partial remainder (u -= w).
-                k = 0;
-                for (size_t i = 0; i < n; ++i)
+                if (!lehmer(u, v, 0, 0, is_odd))
                 {
-                    k = k + r.digits[j + i] - w.digits[i];
-                    r.digits[j + i] = static_cast<Digit>(k);
-                    k = ((k >> BITS) ? -1 : 0);
+                    u %= v;
+                    std::swap(u, v);
                 }
             }
+            if (v == 0)
+            {
+                return u;
+            }
 
-            // Denormalize remainder.
-            q.trim();
-            r.digits.resize(n);
-            r >>= d;
+            // Binary GCD, removing common factors of 2 first.
+            Wigit x = u.extract(0);
+            Wigit y = v.extract(0);
+            unsigned shift = 0;
+            for (; ((x | y) & 1) == 0; x >>= 1, y >>= 1, ++shift);
+            for (; (x & 1) == 0; x >>= 1);
+            while (y != 0)
+            {
+                for (; (y & 1) == 0; y >>= 1);
+                if (x > y)
+                {
+                    std::swap(x, y);
+                }
+                y -= x;
+            }
+            x <<= shift;
+            u.digits.assign(2, 0);
+            u.digits[0] = static_cast<Digit>(x);
+            u.digits[1] = static_cast<Digit>(x >> BITS);
+            u.trim();
+            return u;
         }
 
         friend Unsigned operator<< (Unsigned u, size_t v)
@@ -351,6 +646,12 @@ namespace math
             return u;
         }
 
+        friend Unsigned operator& (const Unsigned& u, Unsigned&& v)
+        {
+            v &= u;
+            return std::move(v);
+        }
+
         Unsigned& operator&= (const Unsigned& rhs)
         {
             const size_t n = rhs.digits.size();
@@ -366,15 +667,13 @@ namespace math
             return *this;
         }
 
+        // Return this & ~v, where ~v has infinitely many leading 1 bits; the
+        // digits of this beyond those of v are kept.
         Unsigned and_not(const Unsigned& v) const
         {
             Unsigned u(*this);
-            const size_t n = v.digits.size();
-            if (u.digits.size() > n)
-            {
-                u.digits.resize(n);
-            }
-            for (size_t j = 0; j < u.digits.size(); ++j)
+            const size_t n = std::min(u.digits.size(), v.digits.size());
+            for (size_t j = 0; j < n; ++j)
             {
                 u.digits[j] &= ~v.digits[j];
             }
@@ -388,6 +687,12 @@ namespace math
             return u;
         }
 
+        friend Unsigned operator^ (const Unsigned& u, Unsigned&& v)
+        {
+            v ^= u;
+            return std::move(v);
+        }
+
         Unsigned& operator^= (const Unsigned& rhs)
         {
             const size_t n = rhs.digits.size();
@@ -409,6 +714,12 @@ namespace math
             return u;
         }
 
+        friend Unsigned operator| (const Unsigned& u, Unsigned&& v)
+        {
+            v |= u;
+            return std::move(v);
+        }
+
         Unsigned& operator|= (const Unsigned& rhs)
         {
             const size_t n = rhs.digits.size();
@@ -460,69 +771,1711 @@ namespace math
             return (u.digits != v.digits);
         }
 
-        // Return 1 + floor(log2(u)), or 0 for u == 0.
-        int bits() const
+        friend bool operator< (const Unsigned& u, Digit v)
         {
-            size_t count = (digits.size() - 1) * BITS;
-            for (Digit u = digits.back(); u != 0; u >>= 1, ++count);
-            return static_cast<int>(count);
+            return (u.digits.size() == 1 && u.digits[0] < v);
         }
 
-        Digit to_uint() const
+        friend bool operator< (Digit u, const Unsigned& v)
         {
-            return digits[0];
+            return (v.digits.size() > 1 || u < v.digits[0]);
         }
 
-        std::string to_string() const
+        friend bool operator> (const Unsigned& u, Digit v)
         {
-            std::ostringstream oss;
-            Unsigned q(*this), r;
-            do
-            {
-                q.divide(10, q, r);
-                oss << r.digits[0];
-            } while (q.digits.back() != 0);
-            std::string s(oss.str());
-            std::reverse(s.begin(), s.end());
-            return s;
+            return (v < u);
         }
 
-        friend std::ostream& operator<< (std::ostream& os, const Unsigned& u)
+        friend bool operator> (Digit u, const Unsigned& v)
         {
-            os << u.to_string();
-            return os;
+            return (v < u);
         }
 
-        friend std::istream& operator>> (std::istream& is, Unsigned& u)
+        friend bool operator<= (const Unsigned& u, Digit v)
         {
-            char digit = '\0';
-            is >> digit;
-            if (is.good() && std::isdigit(digit))
-            {
-                u = digit - '0';
-                while (std::isdigit(is.peek()))
-                {
-                    is >> digit;
-                    u = 10 * u + (digit - '0');
-                }
-            }
-            else
-            {
-                is.setstate(std::ios_base::failbit);
-            }
-            return is;
+            return !(v < u);
         }
 
-    private:
-        std::vector<Digit> digits;
-
-        void trim()
+        friend bool operator<= (Digit u, const Unsigned& v)
+        {
+            return !(v < u);
+        }
+
+        friend bool operator>= (const Unsigned& u, Digit v)
+        {
+            return !(u < v);
+        }
+
+        friend bool operator>= (Digit u, const Unsigned& v)
+        {
+            return !(u < v);
+        }
+
+        friend bool operator== (const Unsigned& u, Digit v)
+        {
+            return (u.digits.size() == 1 && u.digits[0] == v);
+        }
+
+        friend bool operator== (Digit u, const Unsigned& v)
+        {
+            return (v == u);
+        }
+
+        friend bool operator!= (const Unsigned& u, Digit v)
+        {
+            return !(u == v);
+        }
+
+        friend bool operator!= (Digit u, const Unsigned& v)
+        {
+            return !(v == u);
+        }
+
+        // Return -1, 0, or 1 as u1*v1 is less than, equal to, or greater
+        // than u2*v2, multiplying only if bounds from bit lengths and
+        // leading digits do not decide.
+        static int compare_products(const Unsigned& u1, const Unsigned& v1,
+            const Unsigned& u2, const Unsigned& v2)
+        {
+            const int b1 = (u1 == 0 || v1 == 0) ? 0 : u1.bits() + v1.bits();
+            const int b2 = (u2 == 0 || v2 == 0) ? 0 : u2.bits() + v2.bits();
+            if (b1 == 0 || b2 == 0)
+            {
+                return (b1 != 0) - (b2 != 0);
+            }
+
+            // A product of factors with total b bits is in [2^(b-2), 2^b).
+            if (b1 > b2 + 1)
+            {
+                return 1;
+            }
+            if (b2 > b1 + 1)
+            {
+                return -1;
+            }
+
+            // Bound each product using the leading K bits of its factors,
+            // with f in [F*2^k, (F+1)*2^k), and K small enough that bounds
+            // aligned to a common exponent fit in a Wigit.
+            const int K = BITS - 3;
+            int k[4];
+            Wigit f[4];
+            const Unsigned* const x[4] = { &u1, &v1, &u2, &v2 };
+            for (int j = 0; j < 4; ++j)
+            {
+                k[j] = std::max(0, x[j]->bits() - K);
+                f[j] = x[j]->extract(k[j]);
+            }
+            const int e1 = k[0] + k[1];
+            const int e2 = k[2] + k[3];
+            const int e = std::min(e1, e2);
+            const Wigit lo1 = (f[0] * f[1]) << (e1 - e);
+            const Wigit hi1 = ((f[0] + 1) * (f[1] + 1)) << (e1 - e);
+            const Wigit lo2 = (f[2] * f[3]) << (e2 - e);
+            const Wigit hi2 = ((f[2] + 1) * (f[3] + 1)) << (e2 - e);
+            if (lo1 >= hi2)
+            {
+                return 1;
+            }
+            if (lo2 >= hi1)
+            {
+                return -1;
+            }
+            const Unsigned p1 = u1 * v1;
+            const Unsigned p2 = u2 * v2;
+            return (p2 < p1) - (p1 < p2);
+        }
+
+        // Return 1 + floor(log2(u)), or 0 for u == 0.
+        int bits() const
+        {
+            size_t count = (digits.size() - 1) * BITS;
+            for (Digit u = digits.back(); u != 0; u >>= 1, ++count);
+            return static_cast<int>(count);
+        }
+
+        Digit to_uint() const
+        {
+            return digits[0];
+        }
+
+        bool test_bit(size_t k) const
+        {
+            const size_t j = k / BITS;
+            return (j < digits.size() && ((digits[j] >> (k % BITS)) & 1) != 0);
+        }
+
+        void set_bit(size_t k)
+        {
+            const size_t j = k / BITS;
+            if (j >= digits.size())
+            {
+                digits.resize(j + 1, 0);
+            }
+            digits[j] |= static_cast<Digit>(1) << (k % BITS);
+        }
+
+        void clear_bit(size_t k)
+        {
+            const size_t j = k / BITS;
+            if (j < digits.size())
+            {
+                digits[j] &= ~(static_cast<Digit>(1) << (k % BITS));
+                trim();
+            }
+        }
+
+        // Return number of 1 bits.
+        size_t popcount() const
+        {
+            size_t count = 0;
+            for (size_t j = 0; j < digits.size(); ++j)
+            {
+                count += popcount(digits[j]);
+            }
+            return count;
+        }
+
+        // Return index of least significant 1 bit, or 0 for u == 0.
+        size_t lowest_set_bit() const
+        {
+            size_t j = 0;
+            for (; j + 1 < digits.size() && digits[j] == 0; ++j);
+            return j * BITS + trailing_zeros(digits[j]);
+        }
+
+        std::string to_string() const
+        {
+            // Compute powers[k] = DECIMAL_BASE^(2^k), up to about half size.
+            std::vector<Unsigned> powers(1, DECIMAL_BASE);
+            while (4 * powers.back().digits.size() <= digits.size())
+            {
+                powers.push_back(powers.back() * powers.back());
+            }
+            std::string s;
+            append_decimal(s, 0, powers);
+            return s;
+        }
+
+        friend std::ostream& operator<< (std::ostream& os, const Unsigned& u)
+        {
+            os << u.to_string();
+            return os;
+        }
+
+        friend std::istream& operator>> (std::istream& is, Unsigned& u)
+        {
+            char digit = '\0';
+            is >> digit;
+            if (is.good() && std::isdigit(digit))
+            {
+                std::string s(1, digit);
+                while (std::isdigit(is.peek()))
+                {
+                    s.push_back(static_cast<char>(is.get()));
+                }
+
+                // Compute powers[k] = DECIMAL_BASE^(2^k), up to about half
+                // length.
+                std::vector<Unsigned> powers(1, DECIMAL_BASE);
+                while ((DECIMAL_DIGITS << powers.size()) < s.size())
+                {
+                    powers.push_back(powers.back() * powers.back());
+                }
+                u = parse_decimal(s.data(), s.size(), powers);
+            }
+            else
+            {
+                is.setstate(std::ios_base::failbit);
+            }
+            return is;
+        }
+
+    private:
+        // Inline Integer values, precomputed moduli, and divisors work
+        // directly on digits and limb kernels.
+        friend class Integer;
+        friend class ModContext;
+        friend class Divisor;
+
+        // Number of limbs stored without heap allocation.
+        static const size_t INLINE_DIGITS = 4;
+
+        // Limb vector that keeps up to INLINE_DIGITS limbs in place, and
+        // spills to the heap only when it grows beyond that.
+        class Digits
+        {
+        public:
+            Digits(size_t n, Digit value) :
+                ptr(local),
+                count(0),
+                capacity(INLINE_DIGITS)
+            {
+                assign(n, value);
+            }
+
+            Digits(const Digits& copy) :
+                ptr(local),
+                count(0),
+                capacity(INLINE_DIGITS)
+            {
+                assign(copy.begin(), copy.end());
+            }
+
+            // Leaves copy equal to the single limb 0.
+            Digits(Digits&& copy) noexcept :
+                ptr(local),
+                count(0),
+                capacity(INLINE_DIGITS)
+            {
+                take(copy);
+            }
+
+            ~Digits()
+            {
+                release();
+            }
+
+            Digits& operator= (const Digits& rhs)
+            {
+                if (this != &rhs)
+                {
+                    assign(rhs.begin(), rhs.end());
+                }
+                return *this;
+            }
+
+            Digits& operator= (Digits&& rhs) noexcept
+            {
+                if (this != &rhs)
+                {
+                    release();
+                    take(rhs);
+                }
+                return *this;
+            }
+
+            void swap(Digits& other)
+            {
+                Digits t(std::move(other));
+                other = std::move(*this);
+                *this = std::move(t);
+            }
+
+            size_t size() const { return count; }
+            Digit* data() { return ptr; }
+            const Digit* data() const { return ptr; }
+            Digit* begin() { return ptr; }
+            const Digit* begin() const { return ptr; }
+            Digit* end() { return ptr + count; }
+            const Digit* end() const { return ptr + count; }
+            Digit& operator[] (size_t j) { return ptr[j]; }
+            const Digit& operator[] (size_t j) const { return ptr[j]; }
+            Digit& back() { return ptr[count - 1]; }
+            const Digit& back() const { return ptr[count - 1]; }
+
+            void reserve(size_t n)
+            {
+                if (n > capacity)
+                {
+                    grow(std::max(n, 2 * capacity));
+                }
+            }
+
+            void resize(size_t n, Digit value = 0)
+            {
+                reserve(n);
+                if (n > count)
+                {
+                    std::fill(ptr + count, ptr + n, value);
+                }
+                count = n;
+            }
+
+            void push_back(Digit value)
+            {
+                reserve(count + 1);
+                ptr[count++] = value;
+            }
+
+            void pop_back()
+            {
+                --count;
+            }
+
+            void assign(size_t n, Digit value)
+            {
+                count = 0;
+                resize(n, value);
+            }
+
+            // Source range may not overlap this.
+            void assign(const Digit* first, const Digit* last)
+            {
+                const size_t n = static_cast<size_t>(last - first);
+                count = 0;
+                reserve(n);
+                std::copy(first, last, ptr);
+                count = n;
+            }
+
+            void insert(Digit* pos, size_t n, Digit value)
+            {
+                const size_t j = static_cast<size_t>(pos - ptr);
+                reserve(count + n);
+                std::copy_backward(ptr + j, ptr + count, ptr + count + n);
+                std::fill(ptr + j, ptr + j + n, value);
+                count += n;
+            }
+
+            void erase(Digit* first, Digit* last)
+            {
+                count = static_cast<size_t>(
+                    std::copy(last, ptr + count, first) - ptr);
+            }
+
+            friend bool operator== (const Digits& u, const Digits& v)
+            {
+                return u.count == v.count &&
+                    std::equal(u.begin(), u.end(), v.begin());
+            }
+
+            friend bool operator!= (const Digits& u, const Digits& v)
+            {
+                return !(u == v);
+            }
+
+        private:
+            Digit* ptr;
+            size_t count;
+            size_t capacity;
+            Digit local[INLINE_DIGITS];
+
+            void grow(size_t n)
+            {
+                Digit* p = new Digit[n];
+                std::copy(ptr, ptr + count, p);
+                release();
+                ptr = p;
+                capacity = n;
+            }
+
+            void release()
+            {
+                if (ptr != local)
+                {
+                    delete[] ptr;
+                    ptr = local;
+                    capacity = INLINE_DIGITS;
+                }
+            }
+
+            // Move contents of other (in released state) into this.
+            void take(Digits& other)
+            {
+                if (other.ptr != other.local)
+                {
+                    ptr = other.ptr;
+                    capacity = other.capacity;
+                    other.ptr = other.local;
+                    other.capacity = INLINE_DIGITS;
+                }
+                else
+                {
+                    std::copy(other.local, other.local + other.count, local);
+                }
+                count = other.count;
+                other.local[0] = 0;
+                other.count = 1;
+            }
+        };
+
+        Digits digits;
+
+        void trim()
         {
             while (digits.back() == 0 && digits.size() > 1)
             {
                 digits.pop_back();
             }
         }
+
+        static size_t popcount(Digit u)
+        {
+#if defined(__GNUC__)
+            return static_cast<size_t>(__builtin_popcountll(u));
+#else
+            size_t count = 0;
+            for (; u != 0; u &= u - 1, ++count);
+            return count;
+#endif
+        }
+
+        // Return number of trailing zero bits in u, or 0 for u == 0.
+        static size_t trailing_zeros(Digit u)
+        {
+            if (u == 0)
+            {
+                return 0;
+            }
+#if defined(__GNUC__)
+            return static_cast<size_t>(__builtin_ctzll(u));
+#else
+            size_t count = 0;
+            for (; (u & 1) == 0; u >>= 1, ++count);
+            return count;
+#endif
+        }
+
+        // Add 2^k to this.
+        void add_bit(size_t k)
+        {
+            const size_t j = k / BITS;
+            if (j >= digits.size())
+            {
+                digits.resize(j + 1, 0);
+            }
+            const Digit v = static_cast<Digit>(1) << (k % BITS);
+            digits[j] += v;
+            if (digits[j] < v)
+            {
+                size_t i = j + 1;
+                for (; i < digits.size() && ++digits[i] == 0; ++i);
+                if (i == digits.size())
+                {
+                    digits.push_back(1);
+                }
+            }
+        }
+
+        // Subtract 2^k from this, which must be at least 2^k.
+        void sub_bit(size_t k)
+        {
+            const size_t j = k / BITS;
+            const Digit v = static_cast<Digit>(1) << (k % BITS);
+            const Digit borrow = (digits[j] < v);
+            digits[j] -= v;
+            if (borrow != 0)
+            {
+                for (size_t i = j + 1; digits[i]-- == 0; ++i);
+            }
+            trim();
+        }
+
+        // Append decimal digits of this to s, zero-padded to width.
+        void append_decimal(std::string& s, size_t width,
+            const std::vector<Unsigned>& powers) const
+        {
+            const size_t n = digits.size();
+            if (n < TO_STRING_THRESHOLD)
+            {
+                // Convert DECIMAL_DIGITS at a time, least significant first.
+                Unsigned q(*this);
+                std::string t;
+                for (size_t m = n; m != 0 && q.digits[m - 1] != 0;)
+                {
+                    Digit r = div_1(q.digits.data(), q.digits.data(), m,
+                        DECIMAL_BASE);
+                    for (; m != 0 && q.digits[m - 1] == 0; --m);
+                    for (size_t j = 0; j < DECIMAL_DIGITS; ++j, r /= 10)
+                    {
+                        t.push_back(static_cast<char>('0' + r % 10));
+                    }
+                }
+                t.erase(t.find_last_not_of('0') + 1);
+                t.resize(std::max(width, std::max(t.size(), size_t(1))), '0');
+                s.append(t.rbegin(), t.rend());
+                return;
+            }
+
+            // Split this = q * powers[k] + r, with powers[k] about half size.
+            size_t k = 0;
+            while (k + 1 < powers.size() &&
+                2 * powers[k + 1].digits.size() <= n)
+            {
+                ++k;
+            }
+            Unsigned q, r;
+            divide(powers[k], q, r);
+            const size_t r_width = DECIMAL_DIGITS << k;
+            q.append_decimal(s, (width > r_width) ? width - r_width : 0,
+                powers);
+            r.append_decimal(s, r_width, powers);
+        }
+
+        // Return value of decimal digits s[0, n).
+        static Unsigned parse_decimal(const char* s, size_t n,
+            const std::vector<Unsigned>& powers)
+        {
+            if (n < DECIMAL_DIGITS * FROM_STRING_THRESHOLD)
+            {
+                // Compute u = u * DECIMAL_BASE + (next DECIMAL_DIGITS).
+                Unsigned u;
+                for (size_t i = 0, j = (n - 1) % DECIMAL_DIGITS + 1; i < n;
+                    j += DECIMAL_DIGITS)
+                {
+                    Wigit k = 0;
+                    for (; i < j; ++i)
+                    {
+                        k = k * 10 + (s[i] - '0');
+                    }
+                    for (size_t i2 = 0; i2 < u.digits.size(); ++i2)
+                    {
+                        k += static_cast<Wigit>(u.digits[i2]) * DECIMAL_BASE;
+                        u.digits[i2] = static_cast<Digit>(k);
+                        k >>= BITS;
+                    }
+                    if (k != 0)
+                    {
+                        u.digits.push_back(static_cast<Digit>(k));
+                    }
+                }
+                u.trim();
+                return u;
+            }
+
+            // Split s = high * powers[k] + low, with low about half length.
+            size_t k = 0;
+            while ((DECIMAL_DIGITS << (k + 1)) < n)
+            {
+                ++k;
+            }
+            const size_t low = DECIMAL_DIGITS << k;
+            Unsigned u = parse_decimal(s, n - low, powers) * powers[k];
+            u += parse_decimal(s + n - low, low, powers);
+            return u;
+        }
+
+        // Return a copy of digits [j, j + n), or 0 if out of range.
+        Unsigned slice(size_t j, size_t n) const
+        {
+            Unsigned w;
+            if (j < digits.size())
+            {
+                n = std::min(n, digits.size() - j);
+                w.digits.assign(digits.begin() + j, digits.begin() + j + n);
+                w.trim();
+            }
+            return w;
+        }
+
+        // Add v * BASE^j to this.
+        void add_shifted(const Unsigned& v, size_t j)
+        {
+            const size_t n = v.digits.size() + j;
+            if (digits.size() < n)
+            {
+                digits.resize(n, 0);
+            }
+            if (add(&digits[j], &digits[j], digits.size() - j,
+                v.digits.data(), v.digits.size()) != 0)
+            {
+                digits.push_back(1);
+            }
+            trim();
+        }
+
+        // Largest power of 10 in a digit, and its number of decimal digits.
+#ifdef MATH_DIGIT64
+        static const Digit DECIMAL_BASE = UINT64_C(10000000000000000000);
+        static const size_t DECIMAL_DIGITS = 19;
+#else
+        static const Digit DECIMAL_BASE = 1000000000;
+        static const size_t DECIMAL_DIGITS = 9;
+#endif
+
+        // Size (in digits) above which decimal conversion divides and
+        // conquers.
+        static const size_t TO_STRING_THRESHOLD = 40;
+        static const size_t FROM_STRING_THRESHOLD = 40;
+
+        // Operand sizes (in digits) above which each multiplication
+        // algorithm takes over.
+        static const size_t KARATSUBA_THRESHOLD = 32;
+        static const size_t KARATSUBA_SQR_THRESHOLD = 48;
+        static const size_t TOOM3_THRESHOLD = 160;
+        static const size_t NTT_THRESHOLD = 4000;
+
+        // Divisor sizes (in digits) above which each division algorithm
+        // takes over.
+        static const size_t BZ_THRESHOLD = 60;
+        static const size_t NEWTON_THRESHOLD = 4000;
+
+        // Operand size (in digits) above which GCD uses half-GCD.
+        static const size_t HGCD_THRESHOLD = 300;
+
+        // Maximum product size (in digits) supported by multiply_ntt().
+        static const size_t NTT_MAX_DIGITS = (size_t(1) << 24) / (BITS / 32);
+
+        // Number-theoretic transform modulo prime p = c*2^k + 1 < 2^31 with
+        // primitive root g, using Montgomery multiplication (R = 2^32).
+        class Ntt
+        {
+        public:
+            Ntt(std::uint32_t prime, std::uint32_t root) :
+                p(prime),
+                g(root),
+                p_neg_inv(1),
+                r2(static_cast<std::uint32_t>(
+                    (~static_cast<std::uint64_t>(0) % p + 1) % p))
+            {
+                for (int j = 0; j < 5; ++j)
+                {
+                    p_neg_inv *= 2 - p * p_neg_inv;
+                }
+                p_neg_inv = 0 - p_neg_inv;
+            }
+
+            // Return x^y mod p.
+            std::uint64_t pow(std::uint64_t x, std::uint64_t y) const
+            {
+                std::uint64_t z = 1;
+                for (; y != 0; y >>= 1, x = x * x % p)
+                {
+                    if ((y & 1) != 0)
+                    {
+                        z = z * x % p;
+                    }
+                }
+                return z;
+            }
+
+            // Compute a = a * b mod p (cyclic convolution), with power-of-2
+            // size; b may be a itself, saving one transform.
+            void convolve(std::vector<std::uint32_t>& a,
+                std::vector<std::uint32_t>& b) const
+            {
+                const size_t size = a.size();
+                for (size_t j = 0; j < size; ++j)
+                {
+                    a[j] %= p;
+                    b[j] %= p;
+                }
+                std::vector<std::uint32_t> roots(size);
+                make_roots(roots, false);
+                forward(a, roots);
+                if (&b != &a)
+                {
+                    forward(b, roots);
+                }
+
+                // Multiply pointwise, scaling by 1/size.
+                const std::uint32_t s = to_mont(to_mont(
+                    static_cast<std::uint32_t>(pow(size, p - 2))));
+                for (size_t j = 0; j < size; ++j)
+                {
+                    a[j] = mul(mul(a[j], b[j]), s);
+                }
+                make_roots(roots, true);
+                inverse(a, roots);
+            }
+
+        private:
+            std::uint32_t p;
+            std::uint32_t g;
+            std::uint32_t p_neg_inv;
+            std::uint32_t r2;
+
+            // Return x*y/R mod p.
+            std::uint32_t mul(std::uint32_t x, std::uint32_t y) const
+            {
+                const std::uint64_t xy = static_cast<std::uint64_t>(x) * y;
+                const std::uint32_t m = static_cast<std::uint32_t>(xy) *
+                    p_neg_inv;
+                const std::uint32_t z = static_cast<std::uint32_t>(
+                    (xy + static_cast<std::uint64_t>(m) * p) >> 32);
+                return (z >= p ? z - p : z);
+            }
+
+            // Return x*R mod p.
+            std::uint32_t to_mont(std::uint32_t x) const
+            {
+                return mul(x, r2);
+            }
+
+            // Compute roots[h + j] = w^j (Montgomery form), for each power
+            // of 2 h < size, where w is a primitive (2h)-th root of unity.
+            void make_roots(std::vector<std::uint32_t>& roots,
+                bool is_inverse) const
+            {
+                for (size_t h = 1; h < roots.size(); h <<= 1)
+                {
+                    std::uint64_t w = pow(g, (p - 1) / (2 * h));
+                    if (is_inverse)
+                    {
+                        w = pow(w, p - 2);
+                    }
+                    const std::uint32_t wm =
+                        to_mont(static_cast<std::uint32_t>(w));
+                    roots[h] = to_mont(1);
+                    for (size_t j = 1; j < h; ++j)
+                    {
+                        roots[h + j] = mul(roots[h + j - 1], wm);
+                    }
+                }
+            }
+
+            // Decimation in frequency, output in bit-reversed order.
+            void forward(std::vector<std::uint32_t>& a,
+                const std::vector<std::uint32_t>& roots) const
+            {
+                const Ntt f(*this); // local copy, not aliased by a
+                std::uint32_t* const d = a.data();
+                const std::uint32_t* const r = roots.data();
+                for (size_t h = a.size() / 2; h != 0; h >>= 1)
+                {
+                    for (size_t i = 0; i < a.size(); i += 2 * h)
+                    {
+                        for (size_t j = 0; j < h; ++j)
+                        {
+                            const std::uint32_t x = d[i + j];
+                            const std::uint32_t y = d[i + j + h];
+                            d[i + j] = (x + y >= f.p ? x + y - f.p : x + y);
+                            d[i + j + h] = f.mul(x >= y ? x - y : x + f.p - y,
+                                r[h + j]);
+                        }
+                    }
+                }
+            }
+
+            // Decimation in time, input in bit-reversed order.
+            void inverse(std::vector<std::uint32_t>& a,
+                const std::vector<std::uint32_t>& roots) const
+            {
+                const Ntt f(*this); // local copy, not aliased by a
+                std::uint32_t* const d = a.data();
+                const std::uint32_t* const r = roots.data();
+                for (size_t h = 1; h < a.size(); h <<= 1)
+                {
+                    for (size_t i = 0; i < a.size(); i += 2 * h)
+                    {
+                        for (size_t j = 0; j < h; ++j)
+                        {
+                            const std::uint32_t x = d[i + j];
+                            const std::uint32_t y = f.mul(d[i + j + h],
+                                r[h + j]);
+                            d[i + j] = (x + y >= f.p ? x + y - f.p : x + y);
+                            d[i + j + h] = (x >= y ? x - y : x + f.p - y);
+                        }
+                    }
+                }
+            }
+        };
+
+#ifdef MATH_KERNELS_ADX
+        // Table of limb kernels, selected once for the running CPU.
+        struct Kernels
+        {
+            Digit (*add_n)(Digit* w, const Digit* u, const Digit* v,
+                size_t n);
+            Digit (*sub_n)(Digit* w, const Digit* u, const Digit* v,
+                size_t n);
+            Digit (*mul_1)(Digit* w, const Digit* u, size_t n, Digit v);
+            Digit (*addmul_1)(Digit* w, const Digit* u, size_t n, Digit v);
+        };
+
+        static const Kernels& kernels()
+        {
+            static const Kernels table = select_kernels();
+            return table;
+        }
+
+        static Kernels select_kernels()
+        {
+            Kernels table = {
+                add_n_portable, sub_n_portable,
+                mul_1_portable, addmul_1_portable };
+            // Check CPUID leaf 7 for BMI2 (mulx) and ADX (adcx/adox).
+            unsigned a = 0, b = 0, c = 0, d = 0;
+            if (__get_cpuid_count(7, 0, &a, &b, &c, &d) &&
+                (b & bit_BMI2) != 0 && (b & bit_ADX) != 0)
+            {
+                table.add_n = add_n_adx;
+                table.sub_n = sub_n_adx;
+                table.mul_1 = mul_1_adx;
+                table.addmul_1 = addmul_1_adx;
+            }
+            return table;
+        }
+#endif
+
+        // The wrappers below dispatch through the kernel table only when
+        // there is a faster kernel to choose; otherwise (e.g., 32-bit
+        // digits) they call the portable loops directly.
+
+        // Compute w[0, n) = u[0, n) + v[0, n), and return carry.
+        static Digit add_n(Digit* w, const Digit* u, const Digit* v,
+            size_t n)
+        {
+#ifdef MATH_KERNELS_ADX
+            return kernels().add_n(w, u, v, n);
+#else
+            return add_n_portable(w, u, v, n);
+#endif
+        }
+
+        // Compute w[0, n) = u[0, n) - v[0, n), and return borrow.
+        static Digit sub_n(Digit* w, const Digit* u, const Digit* v,
+            size_t n)
+        {
+#ifdef MATH_KERNELS_ADX
+            return kernels().sub_n(w, u, v, n);
+#else
+            return sub_n_portable(w, u, v, n);
+#endif
+        }
+
+        // Compute w[0, n) = u[0, n) * v, and return carry digit.
+        static Digit mul_1(Digit* w, const Digit* u, size_t n, Digit v)
+        {
+#ifdef MATH_KERNELS_ADX
+            return kernels().mul_1(w, u, n, v);
+#else
+            return mul_1_portable(w, u, n, v);
+#endif
+        }
+
+        // Compute w[0, n) += u[0, n) * v, and return carry digit.
+        static Digit addmul_1(Digit* w, const Digit* u, size_t n, Digit v)
+        {
+#ifdef MATH_KERNELS_ADX
+            return kernels().addmul_1(w, u, n, v);
+#else
+            return addmul_1_portable(w, u, n, v);
+#endif
+        }
+
+        static Digit add_n_portable(Digit* w, const Digit* u,
+            const Digit* v, size_t n)
+        {
+            Wigit k = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                k = k + u[j] + v[j];
+                w[j] = static_cast<Digit>(k);
+                k >>= BITS;
+            }
+            return static_cast<Digit>(k);
+        }
+
+        static Digit sub_n_portable(Digit* w, const Digit* u,
+            const Digit* v, size_t n)
+        {
+            Wigit k = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                k = k + u[j] - v[j];
+                w[j] = static_cast<Digit>(k);
+                k = ((k >> BITS) ? -1 : 0);
+            }
+            return (k != 0);
+        }
+
+        static Digit mul_1_portable(Digit* w, const Digit* u, size_t n,
+            Digit v)
+        {
+            Wigit k = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                k += static_cast<Wigit>(u[j]) * v;
+                w[j] = static_cast<Digit>(k);
+                k >>= BITS;
+            }
+            return static_cast<Digit>(k);
+        }
+
+        static Digit addmul_1_portable(Digit* w, const Digit* u, size_t n,
+            Digit v)
+        {
+            Wigit k = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                k += static_cast<Wigit>(u[j]) * v + w[j];
+                w[j] = static_cast<Digit>(k);
+                k >>= BITS;
+            }
+            return static_cast<Digit>(k);
+        }
+
+#ifdef MATH_KERNELS_ADX
+        // Kernels using add-with-carry intrinsics, and mulx/adcx/adox.
+        typedef unsigned long long Word;
+
+        __attribute__((target("adx,bmi2")))
+        static Digit add_n_adx(Digit* w, const Digit* u, const Digit* v,
+            size_t n)
+        {
+            unsigned char c = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                Word t;
+                c = _addcarryx_u64(c, u[j], v[j], &t);
+                w[j] = t;
+            }
+            return c;
+        }
+
+        __attribute__((target("adx,bmi2")))
+        static Digit sub_n_adx(Digit* w, const Digit* u, const Digit* v,
+            size_t n)
+        {
+            unsigned char c = 0;
+            for (size_t j = 0; j < n; ++j)
+            {
+                Word t;
+                c = _subborrow_u64(c, u[j], v[j], &t);
+                w[j] = t;
+            }
+            return c;
+        }
+
+        // Loop over j = -n, ..., -1 without disturbing flags CF and OF,
+        // with the product hi:lo = u[j] * v from mulx.
+        static Digit mul_1_adx(Digit* w, const Digit* u, size_t n, Digit v)
+        {
+            if (n == 0)
+            {
+                return 0;
+            }
+            Word k, lo, hi;
+            std::ptrdiff_t j = -static_cast<std::ptrdiff_t>(n);
+            __asm__(
+                "xor %k[k], %k[k]\n\t"
+                "1:\n\t"
+                "mulx (%[u],%[j],8), %[lo], %[hi]\n\t"
+                "adcx %[k], %[lo]\n\t"
+                "mov %[lo], (%[w],%[j],8)\n\t"
+                "mov %[hi], %[k]\n\t"
+                "lea 1(%[j]), %[j]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "mov $0, %k[lo]\n\t"
+                "adcx %[lo], %[k]"
+                : [k] "=&r" (k), [lo] "=&r" (lo), [hi] "=&r" (hi),
+                  [j] "+c" (j)
+                : [u] "r" (u + n), [w] "r" (w + n), "d" (v)
+                : "cc", "memory");
+            return k;
+        }
+
+        // As mul_1_adx, adding w[j] by a second carry chain (OF).
+        static Digit addmul_1_adx(Digit* w, const Digit* u, size_t n,
+            Digit v)
+        {
+            if (n == 0)
+            {
+                return 0;
+            }
+            Word k, lo, hi;
+            std::ptrdiff_t j = -static_cast<std::ptrdiff_t>(n);
+            __asm__(
+                "xor %k[k], %k[k]\n\t"
+                "1:\n\t"
+                "mulx (%[u],%[j],8), %[lo], %[hi]\n\t"
+                "adcx %[k], %[lo]\n\t"
+                "adox (%[w],%[j],8), %[lo]\n\t"
+                "mov %[lo], (%[w],%[j],8)\n\t"
+                "mov %[hi], %[k]\n\t"
+                "lea 1(%[j]), %[j]\n\t"
+                "jrcxz 2f\n\t"
+                "jmp 1b\n"
+                "2:\n\t"
+                "mov $0, %k[lo]\n\t"
+                "adcx %[lo], %[k]\n\t"
+                "adox %[lo], %[k]"
+                : [k] "=&r" (k), [lo] "=&r" (lo), [hi] "=&r" (hi),
+                  [j] "+c" (j)
+                : [u] "r" (u + n), [w] "r" (w + n), "d" (v)
+                : "cc", "memory");
+            return k;
+        }
+#endif
+
+        // Compute w[0, m) = u[0, m) + v[0, n), m >= n, and return carry.
+        static Digit add(Digit* w, const Digit* u, size_t m,
+            const Digit* v, size_t n)
+        {
+            Wigit k = add_n(w, u, v, n);
+            for (size_t j = n; j < m; ++j)
+            {
+                k += u[j];
+                w[j] = static_cast<Digit>(k);
+                k >>= BITS;
+            }
+            return static_cast<Digit>(k);
+        }
+
+        // Compute w[0, m) = u[0, m) - v[0, n), m >= n, and return borrow.
+        static Digit sub(Digit* w, const Digit* u, size_t m,
+            const Digit* v, size_t n)
+        {
+            Wigit k = 0 - static_cast<Wigit>(sub_n(w, u, v, n));
+            for (size_t j = n; j < m; ++j)
+            {
+                k += u[j];
+                w[j] = static_cast<Digit>(k);
+                k = ((k >> BITS) ? -1 : 0);
+            }
+            return (k != 0);
+        }
+
+        // Compute w[0, m) = |u[0, m) - v[0, n)|, m >= n, and return true
+        // iff u < v.
+        static bool sub_abs(Digit* w, const Digit* u, size_t m,
+            const Digit* v, size_t n)
+        {
+            size_t j = m;
+            for (; j > n && u[j - 1] == 0; --j);
+            if (j == n)
+            {
+                for (; j != 0 && u[j - 1] == v[j - 1]; --j);
+                if (j != 0 && u[j - 1] < v[j - 1])
+                {
+                    sub_n(w, v, u, n);
+                    std::fill(w + n, w + m, 0);
+                    return true;
+                }
+            }
+            sub(w, u, m, v, n);
+            return false;
+        }
+
+        // Compute q[0, n) = u[0, n) / v, and return remainder.
+        static Digit div_1(Digit* q, const Digit* u, size_t n, Digit v)
+        {
+            Wigit k = 0;
+            for (size_t j = n; j-- != 0;)
+            {
+                k = k << BITS | u[j];
+                q[j] = static_cast<Digit>(k / v);
+                k %= v;
+            }
+            return static_cast<Digit>(k);
+        }
+
+        // Return u[0, n) % v.
+        static Digit mod_1(const Digit* u, size_t n, Digit v)
+        {
+            Wigit k = 0;
+            for (size_t j = n; j-- != 0;)
+            {
+                k = (k << BITS | u[j]) % v;
+            }
+            return static_cast<Digit>(k);
+        }
+
+        // Divide by Knuth's Algorithm D.
+        void divide_knuth(Unsigned v, Unsigned& q, Unsigned& r) const
+        {
+            // Handle special cases (m < n).
+            r.digits = digits;
+            const size_t n = v.digits.size();
+            if (digits.size() < n)
+            {
+                q.digits.assign(1, 0);
+                return;
+            }
+
+            // Normalize divisor (v[n-1] >= BASE/2).
+            unsigned d = BITS;
+            for (Digit vn = v.digits.back(); vn != 0; vn >>= 1, --d);
+            v <<= d;
+            r <<= d;
+            const Digit vn = v.digits.back();
+
+            // Ensure first single-digit quotient (u[m-1] < v[n-1]).
+            r.digits.push_back(0);
+            const size_t m = r.digits.size();
+            q.digits.resize(m - n);
+            Unsigned w;
+            w.digits.resize(n + 1);
+            const Wigit MAX_DIGIT = (static_cast<Wigit>(1) << BITS) - 1;
+            for (size_t j = m - n; j-- != 0;)
+            {
+                // Estimate quotient digit.
+                Wigit qhat = std::min(MAX_DIGIT,
+                    (static_cast<Wigit>(r.digits[j + n]) << BITS |
+                        r.digits[j + n - 1]) / vn);
+
+                // Compute partial product (w = qhat * v).
+                w.digits[n] = mul_1(w.digits.data(), v.digits.data(), n,
+                    static_cast<Digit>(qhat));
+
+                // Check if qhat is too large (u - w < 0).
+                bool is_trial = true;
+                while (is_trial)
+                {
+                    size_t i = n;
+                    for (; i != 0 && r.digits[j + i] == w.digits[i]; --i);
+                    is_trial = (r.digits[j + i] < w.digits[i]);
+                    if (is_trial)
+                    {
+                        // Adjust partial product (w -= v).
+                        --qhat;
+                        w.digits[n] -= sub_n(w.digits.data(), w.digits.data(),
+                            v.digits.data(), n);
+                    }
+                }
+                q.digits[j] = static_cast<Digit>(qhat);
+
+                // Compute partial remainder (u -= w).
+                sub_n(&r.digits[j], &r.digits[j], w.digits.data(), n);
+            }
+
+            // Denormalize remainder.
+            q.trim();
+            r.digits.resize(n);
+            r >>= d;
+        }
+
+        // Recursive division (Burnikel-Ziegler), with normalized n-digit v
+        // and at most 2n-digit u.
+        static void divide_recursive(const Unsigned& u, const Unsigned& v,
+            Unsigned& q, Unsigned& r)
+        {
+            const size_t n = v.digits.size();
+            if (u.digits.size() < n + BZ_THRESHOLD)
+            {
+                u.divide_knuth(v, q, r);
+                return;
+            }
+
+            // If v is longer than the quotient, divide leading digits only,
+            // leaving at most 2 corrections.
+            const size_t m = u.digits.size() - n;
+            Unsigned q1, r1, t;
+            if (m < n)
+            {
+                divide_recursive(u.slice(n - m, n + m), v.slice(n - m, n),
+                    q, r1);
+                r = u.slice(0, n - m);
+                r.add_shifted(r1, n - m);
+                t = q * v.slice(0, n - m);
+                while (r < t)
+                {
+                    r += v;
+                    --q;
+                }
+                r -= t;
+                return;
+            }
+
+            // Split v = v1 * BASE^k + v0, and divide top of u by v1.
+            const size_t k = m / 2;
+            const Unsigned v1 = v.slice(k, n);
+            const Unsigned v0 = v.slice(0, k);
+            divide_recursive(u.slice(2 * k, u.digits.size()), v1, q1, r1);
+
+            // Correct remainder w = u mod BASE^2k + (r1 - q1 * v0) * BASE^k.
+            Unsigned w = u.slice(0, 2 * k);
+            w.add_shifted(r1, 2 * k);
+            t = q1 * v0;
+            t.digits.insert(t.digits.begin(), k, 0);
+            t.trim();
+            while (w < t)
+            {
+                w.add_shifted(v, k);
+                --q1;
+            }
+            w -= t;
+
+            // Divide next k digits.
+            divide_recursive(w.slice(k, w.digits.size()), v1, q, r1);
+            r = w.slice(0, k);
+            r.add_shifted(r1, k);
+            t = q * v0;
+            while (r < t)
+            {
+                r += v;
+                --q;
+            }
+            r -= t;
+            q.add_shifted(q1, k);
+        }
+
+        // Return floor((BASE^2n - 1) / v) for normalized n-digit v, using
+        // Newton iteration.
+        static Unsigned reciprocal(const Unsigned& v)
+        {
+            const size_t n = v.digits.size();
+            Unsigned w;
+            w.digits.assign(2 * n, 0);
+            w.digits.push_back(1);
+            Unsigned x, p;
+            if (n < 2 * BZ_THRESHOLD)
+            {
+                (--w).divide(v, x, p);
+                return x;
+            }
+
+            // Extend reciprocal y of leading h digits to x = y * BASE^(n-h),
+            // and x += x*(w - v*x)/w, with v*y compared to BASE^(n+h).
+            const size_t h = n / 2 + 1;
+            const Unsigned y = reciprocal(v.slice(n - h, h));
+            p = v * y;
+            Unsigned e;
+            e.digits.assign(n + h, 0);
+            e.digits.push_back(1);
+            x = y << ((n - h) * BITS);
+            if (p <= e)
+            {
+                e = (y * (e - p)) >> (2 * h * BITS);
+                x += e;
+                p = (p << ((n - h) * BITS)) + v * e;
+            }
+            else
+            {
+                e = ((y * (p - e)) >> (2 * h * BITS)) + 1;
+                x -= e;
+                p = (p << ((n - h) * BITS)) - v * e;
+            }
+
+            // Correct to exact quotient (p = v*x).
+            while (p >= w)
+            {
+                p -= v;
+                --x;
+            }
+            for (p += v; p < w; p += v)
+            {
+                ++x;
+            }
+            return x;
+        }
+
+#ifdef MATH_DIGIT64
+        __extension__ typedef __int128 SignedWigit;
+#else
+        typedef std::int64_t SignedWigit;
+#endif
+
+        static Digit magnitude(SignedWigit x)
+        {
+            return static_cast<Digit>(x < 0 ? -x : x);
+        }
+
+        // Cofactors of a Euclidean remainder sequence are stored as
+        // magnitudes m = {a, b, c, d}, with (u', v') = (a*u - b*v, d*v - c*u)
+        // negated if is_odd. Compute m = l * m.
+        static void compose(Unsigned* m, bool& is_odd, const Unsigned* l,
+            bool is_l_odd)
+        {
+            const Unsigned a = l[0] * m[0] + l[1] * m[2];
+            const Unsigned b = l[0] * m[1] + l[1] * m[3];
+            const Unsigned c = l[2] * m[0] + l[3] * m[2];
+            m[3] = l[2] * m[1] + l[3] * m[3];
+            m[0] = a;
+            m[1] = b;
+            m[2] = c;
+            is_odd = (is_odd != is_l_odd);
+        }
+
+        // Replace u >= v with (v, u mod v) if the remainder is at least 2^s,
+        // updating cofactors m (if not null). Return false otherwise.
+        static bool euclid(Unsigned& u, Unsigned& v, int s, Unsigned* m,
+            bool& is_odd)
+        {
+            Unsigned q, r;
+            u.divide(v, q, r);
+            if (r.bits() <= s)
+            {
+                return false;
+            }
+            if (m != 0)
+            {
+                const Unsigned l[4] = { 0, 1, 1, q };
+                compose(m, is_odd, l, true);
+            }
+            u = std::move(v);
+            v = std::move(r);
+            return true;
+        }
+
+        // Apply to u >= v the Euclidean quotients that agree for both
+        // bounds of the leading double digits (Knuth's Algorithm L), with
+        // single-digit cofactors, keeping v >= 2^s. Update cofactors m (if
+        // not null), and return false if no quotient was determined.
+        static bool lehmer(Unsigned& u, Unsigned& v, int s, Unsigned* m,
+            bool& is_odd)
+        {
+            const int h = std::max(0,
+                u.bits() - static_cast<int>(2 * BITS - 2));
+            SignedWigit x = static_cast<SignedWigit>(u.extract(h));
+            SignedWigit y = static_cast<SignedWigit>(v.extract(h));
+            const SignedWigit max_digit =
+                (static_cast<SignedWigit>(1) << BITS) - 1;
+            const SignedWigit bound =
+                (s > h) ? static_cast<SignedWigit>(1) << (s - h) : 1;
+            SignedWigit a = 1, b = 0, c = 0, d = 1;
+            bool is_l_odd = false;
+            while (y + c > 0 && y + d > 0)
+            {
+                const SignedWigit q = (x + a) / (y + c);
+                if (q != (x + b) / (y + d))
+                {
+                    break;
+                }
+
+                // Stop before cofactors overflow a digit, or the actual
+                // remainder (within |c| + |d| of y) may drop below 2^s.
+                const SignedWigit t_c = a - q * c;
+                const SignedWigit t_d = b - q * d;
+                const SignedWigit t_y = x - q * y;
+                if (magnitude(t_c) > max_digit || magnitude(t_d) > max_digit ||
+                    t_y - magnitude(t_c) - magnitude(t_d) < bound)
+                {
+                    break;
+                }
+                a = c;
+                b = d;
+                c = t_c;
+                d = t_d;
+                x = y;
+                y = t_y;
+                is_l_odd = !is_l_odd;
+            }
+            if (b == 0)
+            {
+                return false;
+            }
+
+            // Compute (u, v) = (a*u + b*v, c*u + d*v), where the signs of
+            // a and b (and of c and d) differ.
+            const Digit l[4] = {
+                magnitude(a), magnitude(b), magnitude(c), magnitude(d) };
+            const size_t n = u.digits.size();
+            v.digits.resize(n);
+            std::vector<Digit> t(4 * (n + 1));
+            Digit* au = t.data();
+            Digit* bv = au + n + 1;
+            Digit* cu = bv + n + 1;
+            Digit* dv = cu + n + 1;
+            au[n] = mul_1(au, u.digits.data(), n, l[0]);
+            bv[n] = mul_1(bv, v.digits.data(), n, l[1]);
+            cu[n] = mul_1(cu, u.digits.data(), n, l[2]);
+            dv[n] = mul_1(dv, v.digits.data(), n, l[3]);
+            if (is_l_odd)
+            {
+                sub_n(au, bv, au, n);
+                sub_n(dv, cu, dv, n);
+            }
+            else
+            {
+                sub_n(au, au, bv, n);
+                sub_n(dv, dv, cu, n);
+            }
+            u.digits.assign(au, au + n);
+            u.trim();
+            v.digits.assign(dv, dv + n);
+            v.trim();
+            if (m != 0)
+            {
+                const Unsigned lm[4] = { l[0], l[1], l[2], l[3] };
+                compose(m, is_odd, lm, is_l_odd);
+            }
+            return true;
+        }
+
+        // Reduce u >= v by Euclidean steps while v >= 2^s, with
+        // cofactors m (if not null).
+        static void hgcd_base(Unsigned& u, Unsigned& v, int s, Unsigned* m,
+            bool& is_odd)
+        {
+            while (v.bits() > s)
+            {
+                if (!lehmer(u, v, s, m, is_odd) &&
+                    !euclid(u, v, s, m, is_odd))
+                {
+                    break;
+                }
+            }
+        }
+
+        // Half-GCD: reduce n-bit u >= v by Euclidean steps while v >= 2^s,
+        // s = n/2 + 1, with cofactors m (if not null). Each half of the
+        // reduction is computed recursively from leading bits only.
+        static void hgcd(Unsigned& u, Unsigned& v, Unsigned* m, bool& is_odd)
+        {
+            const int s = u.bits() / 2 + 1;
+            if (v.bits() <= s)
+            {
+                return;
+            }
+            if (u.digits.size() >= HGCD_THRESHOLD)
+            {
+                hgcd_leading(u, v, u.bits() / 2, m, is_odd);
+                if (v.bits() > s && !euclid(u, v, s, m, is_odd))
+                {
+                    return;
+                }
+                if (v.bits() > s)
+                {
+                    hgcd_leading(u, v, std::max(0, 2 * s - u.bits()), m,
+                        is_odd);
+                }
+            }
+            hgcd_base(u, v, s, m, is_odd);
+        }
+
+        // Reduce (u >> k, v >> k) by half-GCD, and apply its cofactors to
+        // u >= v, unless the result is out of order (leaving u and v as is).
+        static void hgcd_leading(Unsigned& u, Unsigned& v, int k, Unsigned* m,
+            bool& is_odd)
+        {
+            Unsigned u1 = u >> k;
+            Unsigned v1 = v >> k;
+            Unsigned l[4] = { 1, 0, 0, 1 };
+            bool is_l_odd = false;
+            hgcd(u1, v1, l, is_l_odd);
+            Unsigned au = l[0] * u;
+            Unsigned bv = l[1] * v;
+            Unsigned cu = l[2] * u;
+            Unsigned dv = l[3] * v;
+            if (is_l_odd)
+            {
+                std::swap(au, bv);
+                std::swap(cu, dv);
+            }
+            if (au < bv || dv < cu)
+            {
+                return;
+            }
+            au -= bv;
+            dv -= cu;
+            if (au < dv)
+            {
+                return;
+            }
+            u = std::move(au);
+            v = std::move(dv);
+            if (m != 0)
+            {
+                compose(m, is_odd, l, is_l_odd);
+            }
+        }
+
+        // Return bits [h, h + 2*BITS) of this.
+        Wigit extract(size_t h) const
+        {
+            const size_t j = h / BITS;
+            const unsigned r = h % BITS;
+            Wigit x = 0;
+            for (size_t i = std::min(j + 2, digits.size()); i-- > j;)
+            {
+                x = x << BITS | digits[i];
+            }
+            x >>= r;
+            if (r != 0 && j + 2 < digits.size())
+            {
+                x |= static_cast<Wigit>(digits[j + 2]) << (2 * BITS - r);
+            }
+            return x;
+        }
+
+        // Compute w[0, m + n) = u[0, m) * v[0, n) by schoolbook
+        // multiplication.
+        static void mul_basecase(Digit* w, const Digit* u, size_t m,
+            const Digit* v, size_t n)
+        {
+            std::fill(w, w + m, 0);
+            for (size_t j = 0; j < n; ++j)
+            {
+                w[j + m] = addmul_1(w + j, u, m, v[j]);
+            }
+        }
+
+        // Compute w[0, 2n) = u[0, n)^2, summing each cross product u[i]*u[j]
+        // (i < j) once, doubling, and adding the squares u[i]^2.
+        static void sqr_basecase(Digit* w, const Digit* u, size_t n)
+        {
+            std::fill(w, w + 2 * n, 0);
+            for (size_t i = 0; i + 1 < n; ++i)
+            {
+                w[n + i] = addmul_1(w + 2 * i + 1, u + i + 1, n - i - 1, u[i]);
+            }
+            add_n(w, w, w, 2 * n);
+            Wigit k = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const Wigit x = static_cast<Wigit>(u[i]) * u[i];
+                k = k + w[2 * i] + static_cast<Digit>(x);
+                w[2 * i] = static_cast<Digit>(k);
+                k >>= BITS;
+                k = k + w[2 * i + 1] + (x >> BITS);
+                w[2 * i + 1] = static_cast<Digit>(k);
+                k >>= BITS;
+            }
+        }
+
+        // Return size of scratch space needed by mul() with m >= n digits.
+        static size_t mul_scratch(size_t m)
+        {
+            size_t size = 0;
+            for (; m >= KARATSUBA_THRESHOLD; m = (m + 1) / 2)
+            {
+                size += 2 * m + 3;
+            }
+            return size;
+        }
+
+        // Compute w[0, m + n) = u[0, m) * v[0, n), m >= n, using scratch
+        // space of at least mul_scratch(m) digits.
+        static void mul(Digit* w, const Digit* u, size_t m,
+            const Digit* v, size_t n, Digit* scratch)
+        {
+            if (n < KARATSUBA_THRESHOLD)
+            {
+                mul_basecase(w, u, m, v, n);
+            }
+            else if (m + 1 < 2 * n)
+            {
+                mul_karatsuba(w, u, m, v, n, scratch);
+            }
+            else
+            {
+                // Multiply n-digit chunks of u by v.
+                Digit* t = scratch;
+                mul(w, u, n, v, n, t + 2 * n);
+                for (size_t j = n; j < m; j += n)
+                {
+                    const size_t c = std::min(n, m - j);
+                    mul(t, v, n, u + j, c, t + 2 * n);
+                    const Digit k = add_n(w + j, w + j, t, n);
+                    std::copy(t + n, t + n + c, w + j + n);
+                    add(w + j + n, w + j + n, c, &k, 1);
+                }
+            }
+        }
+
+        // Compute w[0, 2n) = u[0, n)^2, using scratch space of at least
+        // mul_scratch(n) digits.
+        static void sqr(Digit* w, const Digit* u, size_t n, Digit* scratch)
+        {
+            if (n < KARATSUBA_SQR_THRESHOLD)
+            {
+                sqr_basecase(w, u, n);
+            }
+            else
+            {
+                sqr_karatsuba(w, u, n, scratch);
+            }
+        }
+
+        // Karatsuba squaring, with u = u1 * BASE^h + u0, so that
+        // 2*u0*u1 == u0^2 + u1^2 - (u0 - u1)^2.
+        static void sqr_karatsuba(Digit* w, const Digit* u, size_t n,
+            Digit* scratch)
+        {
+            const size_t h = (n + 1) / 2;
+            Digit* p = scratch;
+            Digit* du = p + 2 * h;
+            Digit* next = du + 2 * h + 1;
+            sub_abs(du, u, h, u + h, n - h);
+            sqr(p, du, h, next);
+            sqr(w, u, h, next);
+            sqr(w + 2 * h, u + h, n - h, next);
+
+            // Compute middle term t = u0^2 + u1^2 - p.
+            Digit* t = du;
+            t[2 * h] = add(t, w, 2 * h, w + 2 * h, 2 * n - 2 * h);
+            t[2 * h] -= sub_n(t, t, p, 2 * h);
+            add(w + h, w + h, 2 * n - h, t, std::min(2 * h + 1, 2 * n - h));
+        }
+
+        // Karatsuba multiplication, with u = u1 * BASE^h + u0 and
+        // v = v1 * BASE^h + v0, so that u0*v1 + u1*v0 ==
+        // u0*v0 + u1*v1 - (u0 - u1)*(v0 - v1).
+        static void mul_karatsuba(Digit* w, const Digit* u, size_t m,
+            const Digit* v, size_t n, Digit* scratch)
+        {
+            const size_t h = (m + 1) / 2;
+            Digit* p = scratch;
+            Digit* du = p + 2 * h;
+            Digit* dv = du + h;
+            Digit* next = dv + h + 1;
+            const bool is_negative = (sub_abs(du, u, h, u + h, m - h) !=
+                sub_abs(dv, v, h, v + h, n - h));
+            mul(p, du, h, dv, h, next);
+            mul(w, u, h, v, h, next);
+            mul(w + 2 * h, u + h, m - h, v + h, n - h, next);
+
+            // Compute middle term t = u0*v0 + u1*v1 -/+ p.
+            Digit* t = du;
+            t[2 * h] = add(t, w, 2 * h, w + 2 * h, m + n - 2 * h);
+            if (is_negative)
+            {
+                t[2 * h] += add_n(t, t, p, 2 * h);
+            }
+            else
+            {
+                t[2 * h] -= sub_n(t, t, p, 2 * h);
+            }
+            add(w + h, w + h, m + n - h, t, std::min(2 * h + 1, m + n - h));
+        }
+
+        // Toom-Cook 3-way multiplication, with m >= n > 2m/3, evaluating at
+        // 0, 1, -1, 2, and infinity. If u and v are the same object, each
+        // product is a square.
+        static Unsigned mul_toom3(const Unsigned& u, const Unsigned& v)
+        {
+            const bool is_square = (&u == &v);
+            const size_t k = (u.digits.size() + 2) / 3;
+            const Unsigned u0 = u.slice(0, k);
+            const Unsigned u1 = u.slice(k, k);
+            const Unsigned u2 = u.slice(2 * k, k);
+            const Unsigned v0 = v.slice(0, k);
+            const Unsigned v1 = v.slice(k, k);
+            const Unsigned v2 = v.slice(2 * k, k);
+
+            // Evaluate, tracking the sign of u(-1) and v(-1).
+            Unsigned up = u0 + u2;
+            Unsigned vp = v0 + v2;
+            const bool is_negative = ((up < u1) != (vp < v1));
+            const Unsigned w_neg1 = is_square ?
+                (up < u1 ? u1 - up : up - u1).square() :
+                (up < u1 ? u1 - up : up - u1) * (vp < v1 ? v1 - vp : vp - v1);
+            up += u1;
+            vp += v1;
+            const Unsigned w1 = is_square ? up.square() : up * vp;
+            up = (((u2 << 1) + u1) << 1) + u0;
+            vp = (((v2 << 1) + v1) << 1) + v0;
+            const Unsigned w2 = is_square ? up.square() : up * vp;
+            const Unsigned w0 = is_square ? u0.square() : u0 * v0;
+            const Unsigned w_inf = is_square ? u2.square() : u2 * v2;
+
+            // Interpolate w(x) = r4*x^4 + r3*x^3 + r2*x^2 + r1*x + r0,
+            // keeping all intermediate values non-negative.
+            Unsigned r2 = (is_negative ? w1 - w_neg1 : w1 + w_neg1) >> 1;
+            Unsigned r1 = (is_negative ? w1 + w_neg1 : w1 - w_neg1) >> 1;
+            r2 -= w0;
+            r2 -= w_inf;
+            Unsigned r3 = (w2 - w0 - (r2 << 2) - (w_inf << 4)) >> 1;
+            r3 -= r1;
+            div_1(r3.digits.data(), r3.digits.data(), r3.digits.size(), 3);
+            r3.trim();
+            r1 -= r3;
+
+            // Recompose.
+            Unsigned w = w0;
+            w.add_shifted(r1, k);
+            w.add_shifted(r2, 2 * k);
+            w.add_shifted(r3, 3 * k);
+            w.add_shifted(w_inf, 4 * k);
+            return w;
+        }
+
+        // Multiply n-digit chunks of u by v, with m >= 2n.
+        static Unsigned mul_unbalanced(const Unsigned& u, const Unsigned& v)
+        {
+            const size_t n = v.digits.size();
+            Unsigned w;
+            for (size_t j = 0; j < u.digits.size(); j += n)
+            {
+                w.add_shifted(u.slice(j, n) * v, j);
+            }
+            return w;
+        }
     };
 } // namespace math
 
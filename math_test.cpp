@@ -0,0 +1,58 @@
+// Regression checks; build and run with, e.g.,
+//
+//     g++ -std=c++11 -O2 math_test.cpp -o math_test && ./math_test
+//
+// Each check aborts (via assert) on failure.
+
+#undef NDEBUG
+#include "math_Integer.h"
+#include "math_ModContext.h"
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+using namespace math;
+
+namespace
+{
+    // Return true if f() throws std::overflow_error.
+    template<typename F>
+    bool throws_overflow(F f)
+    {
+        try
+        {
+            f();
+        }
+        catch (const std::overflow_error&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // A zero modulus is a division by zero, and must not be accepted.
+    void test_mod_context_zero()
+    {
+        assert(throws_overflow([] { ModContext m(0); }));
+        assert(!throws_overflow([] { ModContext m(7); }));
+    }
+
+    // Mixed-sign & and | must keep the high digits of the longer operand,
+    // i.e., Unsigned::and_not(v) must not truncate to the length of v.
+    void test_integer_and_not()
+    {
+        const Integer u("1267650600228229401496703205381"); // 2^100 + 5
+        assert((u & -4) == Integer("1267650600228229401496703205380"));
+        assert((-4 & u) == Integer("1267650600228229401496703205380"));
+        assert((-(u - 5) | 1) == Integer("-1267650600228229401496703205375"));
+        assert(Unsigned(5).and_not(Unsigned("1267650600228229401496703205377"))
+            == Unsigned(4));
+    }
+} // namespace
+
+int main()
+{
+    test_mod_context_zero();
+    test_integer_and_not();
+    std::cout << "ok" << std::endl;
+}